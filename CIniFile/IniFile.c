@@ -25,9 +25,33 @@
 #include <errno.h>
 #include <stdint.h>
 
+#if !defined(DM_INI_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || \
+	(defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define DM_INI_USE_SSE2 1
+#include <emmintrin.h>
+#else
+#define DM_INI_USE_SSE2 0
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 #define HASH_SIZE 8675309
 
-IniErrorHint* __IniFile_ErrorHint = NULL;
+#if defined(_MSC_VER)
+#define INI_THREAD_LOCAL __declspec(thread)
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && \
+	!defined(__STDC_NO_THREADS__)
+#define INI_THREAD_LOCAL _Thread_local
+#elif defined(__GNUC__)
+#define INI_THREAD_LOCAL __thread
+#else
+#define INI_THREAD_LOCAL
+#endif
+
+static INI_THREAD_LOCAL IniErrorHint __IniFile_ErrorHint;
+static INI_THREAD_LOCAL bool __IniFile_HasErrorHint = false;
 
 /* Utility methods */
 
@@ -163,50 +187,186 @@ bool startsWith_optimized(const char* str, const char* search, size_t len)
 	return (strncmp(str, search, len) == 0);
 }
 
+static unsigned int __IniFile_CountTrailingZeros(unsigned int value)
+{
+#ifdef _MSC_VER
+	unsigned long index = 0;
+
+	_BitScanForward(&index, value);
+
+	return (unsigned int)index;
+#else
+	return (unsigned int)__builtin_ctz(value);
+#endif
+}
+
+static size_t __IniFile_PopCount(unsigned int value)
+{
+#ifdef _MSC_VER
+	value = value - ((value >> 1) & 0x55555555u);
+	value = (value & 0x33333333u) + ((value >> 2) & 0x33333333u);
+
+	return (size_t)((((value + (value >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24);
+#else
+	return (size_t)__builtin_popcount(value);
+#endif
+}
+
+/* Counts how often c appears in text. */
+static size_t __IniFile_CountByte(const char* text, size_t length, char c)
+{
+	size_t count = 0;
+	size_t i = 0;
+
+#if DM_INI_USE_SSE2
+	{
+		const __m128i needle = _mm_set1_epi8(c);
+
+		for (; i + 16 <= length; i += 16)
+		{
+			__m128i chunk = _mm_loadu_si128((const __m128i*)(text + i));
+
+			count += __IniFile_PopCount((unsigned int)_mm_movemask_epi8(
+				_mm_cmpeq_epi8(chunk, needle)));
+		}
+	}
+#endif
+
+	for (; i < length; ++i)
+	{
+		if (text[i] == c)
+			++count;
+	}
+
+	return count;
+}
+
 /* Error handling code */
 
 void __IniFile_SetErrorHint(const char* message, int code)
 {
-	if (!__IniFile_ErrorHint)
+	__IniFile_SetErrorHintAt(message, code, DM_INI_NO_OFFSET);
+}
+
+void __IniFile_SetErrorHintAt(const char* message, int code, size_t offset)
+{
+	__IniFile_ErrorHint.errorText = message;
+	__IniFile_ErrorHint.errorCode = code;
+	__IniFile_ErrorHint.errorOffset = offset;
+	__IniFile_ErrorHint.errorLine = 0;
+	__IniFile_ErrorHint.errorColumn = 0;
+	__IniFile_HasErrorHint = true;
+}
+
+void __IniFile_ClearErrorHint()
+{
+	__IniFile_HasErrorHint = false;
+}
+
+/* Puts back a hint saved from IniFile_GetErrorHint(). */
+static void __IniFile_RestoreErrorHint(const IniErrorHint* hint)
+{
+	__IniFile_ErrorHint = *hint;
+	__IniFile_HasErrorHint = true;
+}
+
+/*
+ * Works out the line and column of the hint's offset into buffer. Only done
+ * once parsing has failed, so keeping track of lines costs nothing while
+ * it succeeds.
+ */
+static void __IniFile_LocateErrorHint(const char* buffer, size_t length)
+{
+	IniErrorHint* hint = IniFile_GetErrorHint();
+	size_t start = 0;
+
+	if (!hint || hint->errorOffset == DM_INI_NO_OFFSET ||
+		hint->errorOffset > length)
 	{
-		/* TODO: What do if we get here from a malloc error ?! */
-		__IniFile_ErrorHint = (IniErrorHint*)malloc(sizeof(IniErrorHint));
+		return;
 	}
 
-	if (__IniFile_ErrorHint)
+	start = hint->errorOffset;
+
+	while (start > 0 && buffer[start - 1] != '\n')
+		--start;
+
+	hint->errorLine = __IniFile_CountByte(buffer, start, '\n') + 1;
+	hint->errorColumn = hint->errorOffset - start + 1;
+}
+
+/*
+ * Records the current hint, located in buffer, so that parsing can carry on.
+ * Returns false if there is nowhere to record it and parsing has to stop.
+ */
+static bool __IniDiagnostics_Add(IniDiagnostics* diagnostics,
+	const char* buffer, size_t length)
+{
+	IniErrorHint* hint = IniFile_GetErrorHint();
+
+	if (!diagnostics || !hint)
+		return false;
+
+	if (diagnostics->count == diagnostics->capacity)
 	{
-		__IniFile_ErrorHint->errorText = message;
-		__IniFile_ErrorHint->errorCode = code;
+		size_t capacity = diagnostics->capacity ? diagnostics->capacity * 2 : 8;
+		IniErrorHint* list = __IniAllocator_Reallocate(&diagnostics->allocator,
+			diagnostics->list, capacity * sizeof(IniErrorHint));
+
+		if (!list)
+		{
+			__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_MALLOC_FAIL, 9);
+
+			return false;
+		}
+
+		diagnostics->list = list;
+		diagnostics->capacity = capacity;
 	}
+
+	__IniFile_LocateErrorHint(buffer, length);
+
+	diagnostics->list[diagnostics->count++] = *hint;
+
+	__IniFile_ClearErrorHint();
+
+	return true;
 }
 
-void __IniFile_ClearErrorHint()
+void IniDiagnostics_Free(IniDiagnostics* diagnostics)
 {
-	if (!__IniFile_ErrorHint) return;
+	if (!diagnostics) return;
 
-	free(__IniFile_ErrorHint);
+	__IniAllocator_Free(&diagnostics->allocator, diagnostics->list);
 
-	__IniFile_ErrorHint = NULL;
+	diagnostics->list = NULL;
+	diagnostics->count = 0;
+	diagnostics->capacity = 0;
 }
 
 IniErrorHint* IniFile_GetErrorHint()
 {
-	return __IniFile_ErrorHint;
+	return __IniFile_HasErrorHint ? &__IniFile_ErrorHint : NULL;
 }
 
 /* The real meaty parts */
 
-long __IniFile_Hash(const char* str)
+uint32_t __IniFile_HashSpan(const char* data, size_t length)
 {
-	long val = 1;
-	const char* s = str;
+	uint32_t val = 1;
+	size_t i;
 
-	for (val = 1; *s != '\0'; ++s)
+	for (i = 0; i < length; ++i)
 	{
-		val = *s + 179 * val;
+		val = (unsigned char)data[i] + 179 * val;
 	}
 
-	return val % HASH_SIZE;
+	return val;
+}
+
+long __IniFile_Hash(const char* str)
+{
+	return (long)(__IniFile_HashSpan(str, strlen(str)) % HASH_SIZE);
 }
 
 IniItem* IniItem_Initialize()
@@ -214,7 +374,7 @@ IniItem* IniItem_Initialize()
 	IniItem* item = NULL;
 	__IniFile_ClearErrorHint();
 
-	item = malloc(sizeof(IniItem));
+	item = calloc(1, sizeof(IniItem));
 
 	if (!item)
 	{
@@ -231,173 +391,5012 @@ void IniItem_Free(IniItem* item)
 	free(item);
 }
 
-IniSection* IniSection_Initialize()
+size_t IniItem_GetSpanCount(const IniItem* item)
 {
-	IniSection* section = NULL;
+	if (!item) return 0;
 
-	__IniFile_ClearErrorHint();
+	return item->spans ? item->spanCount : 1;
+}
 
-	section = malloc(sizeof(IniSection));
+IniSpan IniItem_GetSpan(const IniItem* item, size_t index)
+{
+	IniSpan span = { NULL, 0 };
 
-	if (!section)
+	if (!item) return span;
+
+	if (item->spans)
 	{
-		__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_MALLOC_FAIL, 6);
+		if (index < item->spanCount)
+			span = item->spans[index];
+	}
+	else if (index == 0)
+	{
+		span.data = item->value;
+		span.length = item->valueLength;
 	}
 
-	return section;
+	return span;
 }
 
-void IniSection_Free(IniSection* section)
+static int __IniFile_HexDigit(char c)
 {
-	IniItem* item = NULL;
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
 
-	if (!section) return;
+	return -1;
+}
+
+/* Reads the four hex digits of a unicode escape, -1 if they aren't any. */
+static long __IniFile_ReadHex4(const char* text, size_t length)
+{
+	long result = 0;
+	size_t i;
 
-	item = section->itemList;
+	if (length < 4)
+		return -1;
 
-	while (item)
+	for (i = 0; i < 4; ++i)
 	{
-		IniItem_Free(item);
+		int digit = __IniFile_HexDigit(text[i]);
 
-		item++;
+		if (digit < 0)
+			return -1;
+
+		result = (result << 4) | digit;
 	}
 
-	free(section);
+	return result;
 }
 
-IniFile* IniFile_ReadFile(const char* filename)
+static size_t __IniFile_EncodeUtf8(unsigned long codepoint, char* destination)
 {
-	FILE* fp = NULL;
-	char* buffer = NULL;
-	size_t lineLength = 0;
+	char bytes[4];
+	size_t length = 0;
 
-	__IniFile_ClearErrorHint();
+	if (codepoint < 0x80)
+	{
+		bytes[length++] = (char)codepoint;
+	}
+	else if (codepoint < 0x800)
+	{
+		bytes[length++] = (char)(0xC0 | (codepoint >> 6));
+		bytes[length++] = (char)(0x80 | (codepoint & 0x3F));
+	}
+	else if (codepoint < 0x10000)
+	{
+		bytes[length++] = (char)(0xE0 | (codepoint >> 12));
+		bytes[length++] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+		bytes[length++] = (char)(0x80 | (codepoint & 0x3F));
+	}
+	else
+	{
+		bytes[length++] = (char)(0xF0 | (codepoint >> 18));
+		bytes[length++] = (char)(0x80 | ((codepoint >> 12) & 0x3F));
+		bytes[length++] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+		bytes[length++] = (char)(0x80 | (codepoint & 0x3F));
+	}
 
-	buffer = malloc(sizeof(char) * DM_INI_MAX_LINE_BUFFER);
+	if (destination)
+		memcpy(destination, bytes, length);
 
-	if (!buffer)
+	return length;
+}
+
+/* Decodes escape sequences. The result is never longer than the input. */
+static size_t __IniFile_Unescape(const char* text, size_t length,
+	char* destination)
+{
+	size_t written = 0;
+	size_t i = 0;
+
+	while (i < length)
 	{
-		__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_MALLOC_FAIL, 7);
+		const char* backslash = memchr(text + i, '\\', length - i);
+		size_t run = backslash ? (size_t)(backslash - text) - i : length - i;
+		char c;
+
+		if (destination)
+			memcpy(destination + written, text + i, run);
+
+		written += run;
+		i += run;
+
+		if (i + 1 >= length)
+		{
+			/* A lone trailing backslash is kept as is. */
+			if (i < length)
+			{
+				if (destination)
+					destination[written] = text[i];
+
+				++written;
+				++i;
+			}
+
+			break;
+		}
+
+		c = text[i + 1];
+		i += 2;
+
+		switch (c)
+		{
+		case 'n': c = '\n'; break;
+		case 't': c = '\t'; break;
+		case 'r': c = '\r'; break;
+		case '"': case '\\': case '/': break;
+		case 'u':
+		{
+			long codepoint = __IniFile_ReadHex4(text + i, length - i);
+
+			if (codepoint < 0)
+			{
+				/* Not a real escape, keep it as written. */
+				if (destination)
+				{
+					destination[written] = '\\';
+					destination[written + 1] = 'u';
+				}
+
+				written += 2;
+
+				continue;
+			}
+
+			i += 4;
+
+			if (codepoint >= 0xD800 && codepoint <= 0xDBFF)
+			{
+				long low = (i + 6 <= length && text[i] == '\\' &&
+					text[i + 1] == 'u') ? __IniFile_ReadHex4(text + i + 2, 4) : -1;
+
+				if (low >= 0xDC00 && low <= 0xDFFF)
+				{
+					codepoint = 0x10000 + ((codepoint - 0xD800) << 10) +
+						(low - 0xDC00);
+					i += 6;
+				}
+				else
+				{
+					codepoint = 0xFFFD;
+				}
+			}
+			else if (codepoint >= 0xDC00 && codepoint <= 0xDFFF)
+			{
+				codepoint = 0xFFFD;
+			}
+
+			written += __IniFile_EncodeUtf8((unsigned long)codepoint,
+				destination ? destination + written : NULL);
+
+			continue;
+		}
+		default:
+			/* Unknown escapes are kept as written. */
+			if (destination)
+				destination[written] = '\\';
+
+			++written;
+			break;
+		}
+
+		if (destination)
+			destination[written] = c;
+
+		++written;
 	}
 
-	fp = fopen(filename, "r");
+	return written;
+}
 
-	if (!fp)
-	{
-		__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_FOPEN_FAIL, errno);
+size_t IniValue_Join(const IniValue* value, char* destination)
+{
+	size_t length = 0;
+	size_t i;
 
-		free(buffer);
+	if (!value) return 0;
 
-		return NULL;
+	if (value->flags & DM_INI_VALUE_ESCAPED)
+	{
+		/* Quoted values never span more than one line. */
+		return __IniFile_Unescape(value->spans[0].data, value->spans[0].length,
+			destination);
 	}
 
-	while (getline(&buffer, &lineLength, fp) != -1)
+	for (i = 0; i < value->spanCount; ++i)
 	{
-		/*printf(buffer);*/
+		const IniSpan* span = &value->spans[i];
+
+		/* The byte after a span tells how its line was continued. */
+		if (i > 0 && value->spans[i - 1].data[value->spans[i - 1].length] !=
+			DM_INI_LINE_CONTINUATION)
+		{
+			if (destination)
+				destination[length] = '\n';
+
+			++length;
+		}
+
+		if (destination)
+			memcpy(destination + length, span->data, span->length);
+
+		length += span->length;
 	}
 
-	free(buffer);
+	return length;
+}
 
-	fclose(fp);
+// Longest number IniValue_ToLong() and IniValue_ToDouble() will look at.
+#define INI_NUMBER_BUFFER 64
 
-	return NULL;
+/* Joins a short value into buffer so it can be handed to strtol and co. */
+static bool __IniValue_ToNumberText(const IniValue* value, char* buffer)
+{
+	size_t length = IniValue_Join(value, NULL);
+
+	if (!length || length >= INI_NUMBER_BUFFER)
+	{
+		__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_BAD_VALUE,
+			DM_INI_ERROR_CODE_BAD_VALUE);
+
+		return false;
+	}
+
+	IniValue_Join(value, buffer);
+	buffer[length] = '\0';
+
+	return true;
 }
 
-void IniFile_Free(IniFile* file)
+bool IniValue_ToLong(const IniValue* value, long* result)
 {
-	IniItem* item = NULL;
-	IniSection* section = NULL;
+	char buffer[INI_NUMBER_BUFFER];
+	char* end = NULL;
+	long parsed = 0;
 
-	if (!file) return;
+	if (!value || !result || !__IniValue_ToNumberText(value, buffer))
+		return false;
 
-	item = file->globalList;
+	errno = 0;
+	parsed = strtol(buffer, &end, 10);
 
-	while (item)
+	if (errno == ERANGE || *end != '\0' || end == buffer)
 	{
-		IniItem_Free(item);
+		__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_BAD_VALUE,
+			DM_INI_ERROR_CODE_BAD_VALUE);
 
-		item++;
+		return false;
 	}
 
-	section = file->sectionList;
+	*result = parsed;
+
+	return true;
+}
+
+bool IniValue_ToDouble(const IniValue* value, double* result)
+{
+	char buffer[INI_NUMBER_BUFFER];
+	char* end = NULL;
+	double parsed = 0;
+
+	if (!value || !result || !__IniValue_ToNumberText(value, buffer))
+		return false;
+
+	parsed = strtod(buffer, &end);
 
-	while (section)
+	if (*end != '\0' || end == buffer)
 	{
-		IniSection_Free(section);
+		__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_BAD_VALUE,
+			DM_INI_ERROR_CODE_BAD_VALUE);
 
-		section++;
+		return false;
 	}
 
-	free(section);
-}
+	*result = parsed;
 
-bool __IniFile_ReadLine(const char* line, IniItem* item, IniItem* section)
-{
-	return false;
+	return true;
 }
 
-bool __IniFile_IsLineCommented(const char* line)
+bool IniValue_ToBool(const IniValue* value, bool* result)
 {
-	if (!line)
+	static const char* const names[] =
+	{
+		"false", "true", "no", "yes", "off", "on", "0", "1"
+	};
+	char buffer[8];
+	size_t length = IniValue_Join(value, NULL);
+	size_t i;
+
+	if (!value || !result)
 		return false;
 
-	/* For simplicity's sake, we consider a blank line a comment. */
-	if (line[0] == '\n')
-		return true;
+	if (length < sizeof(buffer))
+	{
+		IniValue_Join(value, buffer);
+		buffer[length] = '\0';
 
-	if (line[0] == DM_INI_COMMENT_1 || line[0] == DM_INI_COMMENT_2)
-		return true;
+		for (i = 0; i < sizeof(names) / sizeof(names[0]); ++i)
+		{
+			if (strcmp(buffer, names[i]) == 0)
+			{
+				/* Odd entries are the true ones. */
+				*result = (i & 1) != 0;
 
-	if (line[0] == DM_INI_COMMENT_3 && line[1] == DM_INI_COMMENT_3)
-		return true;
+				return true;
+			}
+		}
+	}
 
-	if (line[0] == DM_INI_COMMENT_3 && line[1] == DM_INI_COMMENT_4)
-		return true;
+	__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_BAD_VALUE,
+		DM_INI_ERROR_CODE_BAD_VALUE);
 
 	return false;
 }
 
-bool __IniFile_IsBeginBlockComment(const char* line)
+bool IniValue_ToString(const IniValue* value, char* destination, size_t size)
 {
-	return (line && line[0] == DM_INI_COMMENT_3 &&
-		line[1] == DM_INI_COMMENT_4);
+	size_t length = IniValue_Join(value, NULL);
+
+	if (!value || !destination || length >= size)
+	{
+		__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_BAD_VALUE,
+			DM_INI_ERROR_CODE_BAD_VALUE);
+
+		return false;
+	}
+
+	IniValue_Join(value, destination);
+	destination[length] = '\0';
+
+	return true;
 }
 
-bool __IniFile_IsEndBlockComment(const char* line)
+/* Allocation */
+
+/* Sits in front of each block from a custom allocator so that it can be
+ * given back with its size. Sized to keep what follows it aligned. */
+typedef union
 {
-	size_t len = 0;
+	size_t size;
+	long double alignLongDouble;
+	long long alignLongLong;
+	void* alignPointer;
+} IniAllocationHeader;
 
-	if (!line)
-		return false;
+void* __IniAllocator_Allocate(const IniAllocator* allocator, size_t size)
+{
+	IniAllocationHeader* header = NULL;
 
-	len = strlen(line) - 1;
+	if (!allocator || !allocator->allocate)
+		return malloc(size);
+
+	header = allocator->allocate(allocator->user,
+		sizeof(IniAllocationHeader) + size);
+
+	if (!header)
+		return NULL;
+
+	header->size = size;
 
-	return (line[len - 1] == DM_INI_COMMENT_4 && line[len] == DM_INI_COMMENT_3);
+	return header + 1;
 }
 
-bool __IniFile_IsSectionDeclaration(const char* line)
+void* __IniAllocator_Reallocate(const IniAllocator* allocator, void* pointer,
+	size_t size)
 {
-	size_t len = 0;
+	void* result = NULL;
 
-	if (!line)
-		return false;
+	if (!allocator || !allocator->allocate)
+		return realloc(pointer, size);
 
-	len = strlen(line) - 1;
+	result = __IniAllocator_Allocate(allocator, size);
 
-	return (line[0] == DM_LEFT_BRACKET && line[len] == DM_RIGHT_BRACKET);
+	if (result && pointer)
+	{
+		size_t old = ((IniAllocationHeader*)pointer - 1)->size;
+
+		memcpy(result, pointer, old < size ? old : size);
+
+		__IniAllocator_Free(allocator, pointer);
+	}
+
+	return result;
 }
 
-char* __IniFile_GetSectionName(const char* line)
+void __IniAllocator_Free(const IniAllocator* allocator, void* pointer)
 {
-	size_t len = 0;
+	IniAllocationHeader* header = NULL;
 
-	if (!line)
-		return false;
+	if (!pointer) return;
 
-	len = strlen(line) - 1;
+	if (!allocator || !allocator->allocate)
+	{
+		free(pointer);
 
-	if (!(line[0] == DM_LEFT_BRACKET && line[len] == DM_RIGHT_BRACKET))
-		return NULL;
+		return;
+	}
 
-	return substring(line, 1, len - 1);
+	header = (IniAllocationHeader*)pointer - 1;
+
+	if (allocator->deallocate)
+	{
+		allocator->deallocate(allocator->user, header,
+			sizeof(IniAllocationHeader) + header->size);
+	}
+}
+
+static void* __IniAllocator_AllocateZeroed(const IniAllocator* allocator,
+	size_t size)
+{
+	void* result = __IniAllocator_Allocate(allocator, size);
+
+	if (result)
+		memset(result, 0, size);
+
+	return result;
+}
+
+/* Arena */
+
+struct IniArenaBlock
+{
+	struct IniArenaBlock* next;
+	size_t used;
+	size_t capacity;
+};
+
+#define INI_ARENA_ALIGN 16
+#define INI_ARENA_ROUND(x) \
+	(((x) + INI_ARENA_ALIGN - 1) & ~(size_t)(INI_ARENA_ALIGN - 1))
+#define INI_ARENA_HEADER INI_ARENA_ROUND(sizeof(IniArenaBlock))
+
+void* __IniArena_Allocate(IniArena* arena, size_t size)
+{
+	IniArenaBlock* block = arena->head;
+	char* result = NULL;
+
+	size = INI_ARENA_ROUND(size);
+
+	if (!block || block->capacity - block->used < size)
+	{
+		size_t capacity = size > DM_INI_ARENA_BLOCK_SIZE ? size :
+			DM_INI_ARENA_BLOCK_SIZE;
+
+		block = __IniAllocator_Allocate(arena->allocator,
+			INI_ARENA_HEADER + capacity);
+
+		if (!block)
+		{
+			__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_MALLOC_FAIL, 8);
+
+			return NULL;
+		}
+
+		block->used = 0;
+		block->capacity = capacity;
+
+		/* Oversized blocks go behind the head so its free space isn't lost. */
+		if (arena->head && capacity > DM_INI_ARENA_BLOCK_SIZE)
+		{
+			block->next = arena->head->next;
+			arena->head->next = block;
+		}
+		else
+		{
+			block->next = arena->head;
+			arena->head = block;
+		}
+	}
+
+	result = (char*)block + INI_ARENA_HEADER + block->used;
+	block->used += size;
+
+	return result;
+}
+
+void __IniArena_Free(IniArena* arena)
+{
+	IniArenaBlock* block = arena->head;
+
+	while (block)
+	{
+		IniArenaBlock* next = block->next;
+
+		__IniAllocator_Free(arena->allocator, block);
+
+		block = next;
+	}
+
+	arena->head = NULL;
+}
+
+/* Sections and their item index */
+
+static size_t __IniIndex_Bucket(uint32_t hash, size_t capacity)
+{
+	uint32_t mixed = hash * 2654435761u;
+
+	return (size_t)(mixed ^ (mixed >> 16)) & (capacity - 1);
+}
+
+static void __IniIndex_Place(IniIndex* index, uint32_t hash, size_t position)
+{
+	size_t i = __IniIndex_Bucket(hash, index->capacity);
+
+	while (index->slots[i] && index->slots[i] != DM_INI_INDEX_TOMBSTONE)
+		i = (i + 1) & (index->capacity - 1);
+
+	/* Reusing a tombstone leaves the number of used slots alone. */
+	if (!index->slots[i])
+		index->count++;
+
+	index->slots[i] = (uint32_t)position + 1;
+}
+
+/* Finds the slot holding position, which must be in the index. */
+static size_t __IniIndex_Slot(const IniIndex* index, uint32_t hash,
+	size_t position)
+{
+	size_t i = __IniIndex_Bucket(hash, index->capacity);
+
+	while (index->slots[i] != (uint32_t)position + 1)
+		i = (i + 1) & (index->capacity - 1);
+
+	return i;
+}
+
+/* Adds the last item of the section to its index, growing it if needed. */
+static bool __IniSection_IndexLast(IniSection* section)
+{
+	IniIndex* index = &section->index;
+
+	if ((index->count + 1) * 4 > index->capacity * 3)
+	{
+		size_t capacity = index->capacity ? index->capacity : 16;
+		uint32_t* slots = NULL;
+		size_t i;
+
+		/* Only grow if the live items need it, tombstones just get dropped. */
+		while (section->itemCount * 2 > capacity)
+			capacity *= 2;
+
+		slots = __IniAllocator_AllocateZeroed(section->allocator,
+			capacity * sizeof(uint32_t));
+
+		if (!slots)
+		{
+			__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_MALLOC_FAIL, 10);
+
+			return false;
+		}
+
+		__IniAllocator_Free(section->allocator, index->slots);
+
+		index->slots = slots;
+		index->capacity = capacity;
+		index->count = 0;
+
+		for (i = 0; i < section->itemCount; ++i)
+			__IniIndex_Place(index, section->itemList[i].hash, i);
+
+		return true;
+	}
+
+	__IniIndex_Place(index, section->itemList[section->itemCount - 1].hash,
+		section->itemCount - 1);
+
+	return true;
+}
+
+static IniItem* __IniSection_Find(const IniSection* section, const char* key,
+	size_t keyLength, uint32_t hash)
+{
+	const IniIndex* index = &section->index;
+	size_t i;
+
+	if (!index->capacity)
+		return NULL;
+
+	i = __IniIndex_Bucket(hash, index->capacity);
+
+	while (index->slots[i])
+	{
+		IniItem* item = NULL;
+
+		if (index->slots[i] == DM_INI_INDEX_TOMBSTONE)
+		{
+			i = (i + 1) & (index->capacity - 1);
+
+			continue;
+		}
+
+		item = &section->itemList[index->slots[i] - 1];
+
+		if (item->hash == hash && item->keyLength == keyLength &&
+			memcmp(item->key, key, keyLength) == 0)
+		{
+			return item;
+		}
+
+		i = (i + 1) & (index->capacity - 1);
+	}
+
+	return NULL;
+}
+
+/* Appends a blank item with the given key without indexing it. */
+static IniItem* __IniSection_AppendItem(IniSection* section, const char* key,
+	size_t keyLength, uint32_t hash)
+{
+	IniItem* item = NULL;
+
+	if (section->itemCount == section->itemCapacity)
+	{
+		size_t capacity = section->itemCapacity ? section->itemCapacity * 2 : 8;
+		IniItem* items = __IniAllocator_Reallocate(section->allocator,
+			section->itemList, capacity * sizeof(IniItem));
+
+		if (!items)
+		{
+			__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_MALLOC_FAIL, 9);
+
+			return NULL;
+		}
+
+		section->itemList = items;
+		section->itemCapacity = capacity;
+	}
+
+	item = &section->itemList[section->itemCount++];
+	section->sorted = false;
+
+	memset(item, 0, sizeof(IniItem));
+	item->key = key;
+	item->keyLength = keyLength;
+	item->hash = hash;
+
+	return item;
+}
+
+/* Appends a blank item with the given key and indexes it. */
+static IniItem* __IniSection_AddItem(IniSection* section, const char* key,
+	size_t keyLength, uint32_t hash)
+{
+	IniItem* item = __IniSection_AppendItem(section, key, keyLength, hash);
+
+	if (!item)
+		return NULL;
+
+	if (!__IniSection_IndexLast(section))
+	{
+		section->itemCount--;
+
+		return NULL;
+	}
+
+	return item;
+}
+
+/*
+ * Finds the item with key or appends a blank one, probing the index once.
+ * *found tells which of the two happened.
+ */
+static IniItem* __IniSection_FindOrAdd(IniSection* section, const char* key,
+	size_t keyLength, uint32_t hash, bool* found)
+{
+	IniIndex* index = &section->index;
+	IniItem* item = NULL;
+	size_t slot = SIZE_MAX;
+	size_t i;
+
+	*found = false;
+
+	/* An index that has to grow is rebuilt anyway. */
+	if (!index->capacity || (index->count + 1) * 4 > index->capacity * 3)
+	{
+		item = __IniSection_Find(section, key, keyLength, hash);
+		*found = item != NULL;
+
+		return item ? item : __IniSection_AddItem(section, key, keyLength, hash);
+	}
+
+	i = __IniIndex_Bucket(hash, index->capacity);
+
+	while (index->slots[i])
+	{
+		if (index->slots[i] == DM_INI_INDEX_TOMBSTONE)
+		{
+			if (slot == SIZE_MAX)
+				slot = i;
+		}
+		else
+		{
+			item = &section->itemList[index->slots[i] - 1];
+
+			if (item->hash == hash && item->keyLength == keyLength &&
+				memcmp(item->key, key, keyLength) == 0)
+			{
+				*found = true;
+
+				return item;
+			}
+		}
+
+		i = (i + 1) & (index->capacity - 1);
+	}
+
+	/* The key is new, it goes in the first free slot the probe passed. */
+	if (slot == SIZE_MAX)
+	{
+		slot = i;
+		index->count++;
+	}
+
+	item = __IniSection_AppendItem(section, key, keyLength, hash);
+
+	if (!item)
+	{
+		if (!index->slots[slot])
+			index->count--;
+
+		return NULL;
+	}
+
+	index->slots[slot] = (uint32_t)section->itemCount;
+
+	return item;
+}
+
+/* Removes an item by moving the last item into its place. */
+static void __IniSection_RemoveItem(IniSection* section, IniItem* item)
+{
+	IniIndex* index = &section->index;
+	size_t position = (size_t)(item - section->itemList);
+	size_t last = section->itemCount - 1;
+
+	index->slots[__IniIndex_Slot(index, item->hash, position)] =
+		DM_INI_INDEX_TOMBSTONE;
+
+	if (position != last)
+	{
+		IniItem* moved = &section->itemList[last];
+
+		index->slots[__IniIndex_Slot(index, moved->hash, last)] =
+			(uint32_t)position + 1;
+
+		*item = *moved;
+	}
+
+	section->itemCount--;
+	section->sorted = false;
+}
+
+/* Frees what the section owns, but not the section itself. */
+static void __IniSection_Release(IniSection* section)
+{
+	const IniAllocator* allocator = section->allocator;
+
+	__IniAllocator_Free(allocator, section->itemList);
+	__IniAllocator_Free(allocator, section->index.slots);
+	__IniAllocator_Free(allocator, section->sortedItems);
+
+	memset(section, 0, sizeof(IniSection));
+	section->allocator = allocator;
+}
+
+/* Hierarchical section tree */
+
+#define INI_TREE_NONE UINT32_MAX
+
+static uint32_t __IniTree_Hash(uint32_t parent, const char* name,
+	size_t length)
+{
+	return __IniFile_HashSpan(name, length) ^ (parent * 0x9E3779B1u);
+}
+
+static uint32_t __IniTree_FindChild(const IniSectionTree* tree,
+	uint32_t parent, const char* name, size_t length)
+{
+	uint32_t hash = __IniTree_Hash(parent, name, length);
+	size_t i;
+
+	if (!tree->index.capacity)
+		return INI_TREE_NONE;
+
+	i = __IniIndex_Bucket(hash, tree->index.capacity);
+
+	while (tree->index.slots[i])
+	{
+		const IniTreeNode* node = &tree->nodes[tree->index.slots[i] - 1];
+
+		if (node->hash == hash && node->parent == parent &&
+			node->nameLength == length &&
+			memcmp(node->name, name, length) == 0)
+		{
+			return tree->index.slots[i] - 1;
+		}
+
+		i = (i + 1) & (tree->index.capacity - 1);
+	}
+
+	return INI_TREE_NONE;
+}
+
+static uint32_t __IniTree_AddNode(IniSectionTree* tree, uint32_t parent,
+	const char* name, size_t length, size_t pathLength)
+{
+	IniTreeNode* node = NULL;
+	uint32_t position = 0;
+
+	if (tree->nodeCount == tree->nodeCapacity)
+	{
+		size_t capacity = tree->nodeCapacity ? tree->nodeCapacity * 2 : 16;
+		IniTreeNode* nodes = __IniAllocator_Reallocate(tree->allocator,
+			tree->nodes, capacity * sizeof(IniTreeNode));
+
+		if (!nodes)
+		{
+			__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_MALLOC_FAIL, 9);
+
+			return INI_TREE_NONE;
+		}
+
+		tree->nodes = nodes;
+		tree->nodeCapacity = capacity;
+	}
+
+	if ((tree->index.count + 1) * 4 > tree->index.capacity * 3)
+	{
+		size_t capacity = tree->index.capacity ? tree->index.capacity * 2 : 16;
+		uint32_t* slots = __IniAllocator_AllocateZeroed(tree->allocator,
+			capacity * sizeof(uint32_t));
+		size_t i;
+
+		if (!slots)
+		{
+			__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_MALLOC_FAIL, 10);
+
+			return INI_TREE_NONE;
+		}
+
+		__IniAllocator_Free(tree->allocator, tree->index.slots);
+
+		tree->index.slots = slots;
+		tree->index.capacity = capacity;
+		tree->index.count = 0;
+
+		/* The root is never looked up, so it stays out of the index. */
+		for (i = 1; i < tree->nodeCount; ++i)
+			__IniIndex_Place(&tree->index, tree->nodes[i].hash, i);
+	}
+
+	position = (uint32_t)tree->nodeCount++;
+	node = &tree->nodes[position];
+
+	node->name = name;
+	node->nameLength = length;
+	node->pathLength = pathLength;
+	node->parent = parent;
+	node->firstChild = INI_TREE_NONE;
+	node->lastChild = INI_TREE_NONE;
+	node->nextSibling = INI_TREE_NONE;
+	node->section = INI_TREE_NONE;
+	node->hash = __IniTree_Hash(parent, name, length);
+
+	if (position == 0)
+		return position;
+
+	__IniIndex_Place(&tree->index, node->hash, position);
+
+	if (tree->nodes[parent].lastChild == INI_TREE_NONE)
+		tree->nodes[parent].firstChild = position;
+	else
+		tree->nodes[tree->nodes[parent].lastChild].nextSibling = position;
+
+	tree->nodes[parent].lastChild = position;
+
+	return position;
+}
+
+static void __IniTree_Release(IniSectionTree* tree)
+{
+	const IniAllocator* allocator = tree->allocator;
+
+	__IniAllocator_Free(allocator, tree->nodes);
+	__IniAllocator_Free(allocator, tree->index.slots);
+
+	memset(tree, 0, sizeof(IniSectionTree));
+	tree->allocator = allocator;
+}
+
+/* Builds the tree from the current sections if it isn't already. */
+static bool __IniFile_BuildTree(IniFile* file)
+{
+	IniSectionTree* tree = &file->tree;
+	size_t i;
+
+	if (tree->built)
+		return true;
+
+	__IniTree_Release(tree);
+
+	if (__IniTree_AddNode(tree, 0, "", 0, 0) == INI_TREE_NONE)
+		return false;
+
+	for (i = 0; i < file->sectionCount; ++i)
+	{
+		const char* name = file->sectionList[i].name;
+		size_t start = 0;
+		size_t end = 0;
+		uint32_t node = 0;
+
+		for (;;)
+		{
+			uint32_t child;
+
+			while (name[end] != '\0' && name[end] != DM_INI_PATH_SEPARATOR)
+				++end;
+
+			child = __IniTree_FindChild(tree, node, name + start, end - start);
+
+			if (child == INI_TREE_NONE)
+			{
+				child = __IniTree_AddNode(tree, node, name + start, end - start,
+					end);
+
+				if (child == INI_TREE_NONE)
+				{
+					__IniTree_Release(tree);
+
+					return false;
+				}
+			}
+
+			node = child;
+
+			if (name[end] == '\0')
+				break;
+
+			start = ++end;
+		}
+
+		tree->nodes[node].section = (uint32_t)i;
+	}
+
+	tree->built = true;
+
+	return true;
+}
+
+/* Walks as far down path as the tree goes, returns the last node reached. */
+static uint32_t __IniTree_Walk(const IniSectionTree* tree, const char* path,
+	size_t length, size_t* consumed)
+{
+	uint32_t node = 0;
+	size_t start = 0;
+
+	*consumed = 0;
+
+	while (start < length)
+	{
+		const char* dot = memchr(path + start, DM_INI_PATH_SEPARATOR,
+			length - start);
+		size_t end = dot ? (size_t)(dot - path) : length;
+		uint32_t child = __IniTree_FindChild(tree, node, path + start,
+			end - start);
+
+		if (child == INI_TREE_NONE)
+			break;
+
+		node = child;
+		*consumed = end;
+
+		if (!dot)
+			break;
+
+		start = end + 1;
+	}
+
+	return node;
+}
+
+IniSection* IniSection_Initialize()
+{
+	IniSection* section = NULL;
+
+	__IniFile_ClearErrorHint();
+
+	section = calloc(1, sizeof(IniSection));
+
+	if (!section)
+	{
+		__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_MALLOC_FAIL, 6);
+	}
+
+	return section;
+}
+
+void IniSection_Free(IniSection* section)
+{
+	if (!section) return;
+
+	__IniSection_Release(section);
+
+	free(section);
+}
+
+size_t IniSection_ItemCount(const IniSection* section)
+{
+	if (!section) return 0;
+
+	return section->itemCount;
+}
+
+IniItem* IniSection_ItemAt(IniSection* section, size_t index)
+{
+	if (!section || index >= section->itemCount)
+		return NULL;
+
+	return &section->itemList[index];
+}
+
+void IniOptions_SetDefaults(IniOptions* options)
+{
+	if (!options) return;
+
+	options->nestedComments = false;
+	options->lineContinuation = true;
+	options->indentedContinuation = false;
+	options->skipBom = true;
+	options->validateUtf8 = false;
+	options->dialect = NULL;
+	options->duplicateKeys = IniDuplicate_FirstWins;
+	options->allocator = NULL;
+}
+
+IniFile* IniFile_ReadFile(const char* filename)
+{
+	return IniFile_ReadFileWithOptions(filename, NULL);
+}
+
+/* Converts UTF-16 to UTF-8 a chunk at a time. */
+typedef struct IniUtf16Decoder
+{
+	bool bigEndian;
+
+	/* A high surrogate waiting for the rest of its pair, 0 if none. */
+	unsigned int high;
+	size_t highOffset;
+
+	/* Bytes of input seen so far, for error offsets. */
+	size_t offset;
+} IniUtf16Decoder;
+
+/* Checks for a UTF-16 byte order mark and sets up decoder to follow it. */
+static bool __IniUtf16Decoder_Initialize(IniUtf16Decoder* decoder,
+	const unsigned char* bytes, size_t length)
+{
+	if (length < 2)
+		return false;
+
+	if (bytes[0] == 0xFF && bytes[1] == 0xFE)
+		decoder->bigEndian = false;
+	else if (bytes[0] == 0xFE && bytes[1] == 0xFF)
+		decoder->bigEndian = true;
+	else
+		return false;
+
+	decoder->high = 0;
+	decoder->highOffset = 0;
+	decoder->offset = 2;
+
+	return true;
+}
+
+/*
+ * Converts count code units at bytes, writing at most three bytes of UTF-8
+ * per unit to out. Returns the number of bytes written, or SIZE_MAX with the
+ * error hint set on an unpaired surrogate.
+ */
+static size_t __IniUtf16Decoder_Run(IniUtf16Decoder* decoder,
+	const unsigned char* bytes, size_t count, char* out)
+{
+	unsigned char* written = (unsigned char*)out;
+	size_t i = 0;
+
+	while (i < count)
+	{
+		unsigned int unit = 0;
+
+#if DM_INI_USE_SSE2
+		/* Runs of ASCII narrow 8 units at a time. */
+		if (!decoder->high)
+		{
+			const __m128i notAscii = _mm_set1_epi16((short)0xFF80);
+			const __m128i zero = _mm_setzero_si128();
+
+			while (i + 8 <= count)
+			{
+				__m128i units = _mm_loadu_si128((const __m128i*)(bytes + i * 2));
+
+				if (decoder->bigEndian)
+				{
+					units = _mm_or_si128(_mm_slli_epi16(units, 8),
+						_mm_srli_epi16(units, 8));
+				}
+
+				if (_mm_movemask_epi8(_mm_cmpeq_epi16(
+					_mm_and_si128(units, notAscii), zero)) != 0xFFFF)
+				{
+					break;
+				}
+
+				_mm_storel_epi64((__m128i*)written, _mm_packus_epi16(units, zero));
+
+				written += 8;
+				i += 8;
+			}
+
+			if (i == count)
+				break;
+		}
+#endif
+
+		if (decoder->bigEndian)
+			unit = ((unsigned int)bytes[i * 2] << 8) | bytes[i * 2 + 1];
+		else
+			unit = bytes[i * 2] | ((unsigned int)bytes[i * 2 + 1] << 8);
+
+		if (decoder->high)
+		{
+			unsigned int codePoint = 0;
+
+			if (unit < 0xDC00 || unit > 0xDFFF)
+			{
+				__IniFile_SetErrorHintAt(DM_INI_ERROR_MESSAGE_BAD_UTF16,
+					DM_INI_ERROR_CODE_BAD_UTF16, decoder->highOffset);
+
+				return SIZE_MAX;
+			}
+
+			codePoint = 0x10000 + ((decoder->high - 0xD800) << 10) +
+				(unit - 0xDC00);
+
+			*written++ = (unsigned char)(0xF0 | (codePoint >> 18));
+			*written++ = (unsigned char)(0x80 | ((codePoint >> 12) & 0x3F));
+			*written++ = (unsigned char)(0x80 | ((codePoint >> 6) & 0x3F));
+			*written++ = (unsigned char)(0x80 | (codePoint & 0x3F));
+
+			decoder->high = 0;
+		}
+		else if (unit >= 0xD800 && unit <= 0xDBFF)
+		{
+			decoder->high = unit;
+			decoder->highOffset = decoder->offset + i * 2;
+		}
+		else if (unit >= 0xDC00 && unit <= 0xDFFF)
+		{
+			__IniFile_SetErrorHintAt(DM_INI_ERROR_MESSAGE_BAD_UTF16,
+				DM_INI_ERROR_CODE_BAD_UTF16, decoder->offset + i * 2);
+
+			return SIZE_MAX;
+		}
+		else if (unit < 0x80)
+		{
+			*written++ = (unsigned char)unit;
+		}
+		else if (unit < 0x800)
+		{
+			*written++ = (unsigned char)(0xC0 | (unit >> 6));
+			*written++ = (unsigned char)(0x80 | (unit & 0x3F));
+		}
+		else
+		{
+			*written++ = (unsigned char)(0xE0 | (unit >> 12));
+			*written++ = (unsigned char)(0x80 | ((unit >> 6) & 0x3F));
+			*written++ = (unsigned char)(0x80 | (unit & 0x3F));
+		}
+
+		++i;
+	}
+
+	decoder->offset += count * 2;
+
+	return (size_t)((char*)written - out);
+}
+
+/* Fails if the input ended part way through a code unit or a pair. */
+static bool __IniUtf16Decoder_Finish(const IniUtf16Decoder* decoder,
+	size_t leftover)
+{
+	if (decoder->high)
+	{
+		__IniFile_SetErrorHintAt(DM_INI_ERROR_MESSAGE_BAD_UTF16,
+			DM_INI_ERROR_CODE_BAD_UTF16, decoder->highOffset);
+
+		return false;
+	}
+
+	if (leftover)
+	{
+		__IniFile_SetErrorHintAt(DM_INI_ERROR_MESSAGE_BAD_UTF16,
+			DM_INI_ERROR_CODE_BAD_UTF16, decoder->offset);
+
+		return false;
+	}
+
+	return true;
+}
+
+bool __IniFile_HasUtf16Mark(const char* data, size_t length)
+{
+	IniUtf16Decoder decoder;
+
+	return data && __IniUtf16Decoder_Initialize(&decoder,
+		(const unsigned char*)data, length);
+}
+
+bool __IniFile_DecodeUtf16(const char* data, size_t length,
+	const IniAllocator* allocator, char** text, size_t* textLength)
+{
+	IniUtf16Decoder decoder;
+	size_t count = 0;
+	size_t written = 0;
+	char* buffer = NULL;
+
+	*text = NULL;
+	*textLength = 0;
+
+	if (!data || !__IniUtf16Decoder_Initialize(&decoder,
+		(const unsigned char*)data, length))
+	{
+		return true;
+	}
+
+	count = (length - 2) / 2;
+	buffer = __IniAllocator_Allocate(allocator, count * 3 + 1);
+
+	if (!buffer)
+	{
+		__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_MALLOC_FAIL, 7);
+
+		return false;
+	}
+
+	written = __IniUtf16Decoder_Run(&decoder, (const unsigned char*)data + 2,
+		count, buffer);
+
+	if (written == SIZE_MAX ||
+		!__IniUtf16Decoder_Finish(&decoder, (length - 2) % 2))
+	{
+		__IniAllocator_Free(allocator, buffer);
+
+		return false;
+	}
+
+	buffer[written] = '\0';
+
+	*text = buffer;
+	*textLength = written;
+
+	return true;
+}
+
+/*
+ * Reads the rest of a UTF-16 file as UTF-8, so the UTF-16 text is only ever
+ * held a chunk at a time.
+ */
+static char* __IniFile_ReadUtf16(FILE* fp, IniUtf16Decoder* decoder,
+	size_t* length, const IniAllocator* allocator)
+{
+	unsigned char chunk[DM_INI_MAX_LINE_BUFFER];
+	char* buffer = NULL;
+	size_t capacity = DM_INI_MAX_LINE_BUFFER * 2;
+	size_t used = 0;
+	size_t leftover = 0;
+
+	buffer = __IniAllocator_Allocate(allocator, capacity);
+
+	if (!buffer)
+	{
+		__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_MALLOC_FAIL, 7);
+
+		return NULL;
+	}
+
+	for (;;)
+	{
+		size_t read = fread(chunk + leftover, 1, sizeof(chunk) - leftover, fp);
+		size_t count = (leftover + read) / 2;
+		size_t written = 0;
+
+		if (read == 0)
+		{
+			if (ferror(fp))
+			{
+				__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_FREAD_FAIL, errno);
+
+				__IniAllocator_Free(allocator, buffer);
+
+				return NULL;
+			}
+
+			break;
+		}
+
+		/* Room for the worst case of three bytes per unit and a terminator. */
+		while (capacity - used < count * 3 + 1)
+		{
+			char* grown = __IniAllocator_Reallocate(allocator, buffer,
+				capacity * 2);
+
+			if (!grown)
+			{
+				__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_MALLOC_FAIL, 7);
+
+				__IniAllocator_Free(allocator, buffer);
+
+				return NULL;
+			}
+
+			buffer = grown;
+			capacity *= 2;
+		}
+
+		written = __IniUtf16Decoder_Run(decoder, chunk, count, buffer + used);
+
+		if (written == SIZE_MAX)
+		{
+			__IniAllocator_Free(allocator, buffer);
+
+			return NULL;
+		}
+
+		used += written;
+
+		/* An odd byte starts the next chunk. */
+		leftover = (leftover + read) % 2;
+
+		if (leftover)
+			chunk[0] = chunk[count * 2];
+	}
+
+	if (!__IniUtf16Decoder_Finish(decoder, leftover))
+	{
+		__IniAllocator_Free(allocator, buffer);
+
+		return NULL;
+	}
+
+	buffer[used] = '\0';
+	*length = used;
+
+	return buffer;
+}
+
+/* Reads all of fp into a buffer with one spare byte for a terminator. */
+static char* __IniFile_ReadAll(FILE* fp, size_t* length,
+	const IniAllocator* allocator)
+{
+	IniUtf16Decoder decoder;
+	unsigned char mark[2];
+	char* buffer = NULL;
+	size_t capacity = DM_INI_MAX_LINE_BUFFER;
+	size_t used = 0;
+
+	used = fread(mark, 1, sizeof(mark), fp);
+
+	if (__IniUtf16Decoder_Initialize(&decoder, mark, used))
+		return __IniFile_ReadUtf16(fp, &decoder, length, allocator);
+
+	buffer = __IniAllocator_Allocate(allocator, capacity);
+
+	if (!buffer)
+	{
+		__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_MALLOC_FAIL, 7);
+
+		return NULL;
+	}
+
+	memcpy(buffer, mark, used);
+
+	for (;;)
+	{
+		size_t read = fread(buffer + used, 1, capacity - used - 1, fp);
+
+		used += read;
+
+		if (used + 1 < capacity)
+		{
+			if (ferror(fp))
+			{
+				__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_FREAD_FAIL, errno);
+
+				__IniAllocator_Free(allocator, buffer);
+
+				return NULL;
+			}
+
+			break;
+		}
+		else
+		{
+			char* grown = __IniAllocator_Reallocate(allocator, buffer,
+				capacity * 2);
+
+			if (!grown)
+			{
+				__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_MALLOC_FAIL, 7);
+
+				__IniAllocator_Free(allocator, buffer);
+
+				return NULL;
+			}
+
+			buffer = grown;
+			capacity *= 2;
+		}
+	}
+
+	buffer[used] = '\0';
+	*length = used;
+
+	return buffer;
+}
+
+/* Makes sure item->value is a contiguous, null terminated string. */
+static const char* __IniFile_ResolveValue(IniFile* file, IniItem* item)
+{
+	IniValue value;
+	char* joined = NULL;
+
+	if (item->value)
+		return item->value;
+
+	value.spans = item->spans;
+	value.spanCount = item->spanCount;
+	value.flags = item->flags;
+
+	item->valueLength = IniValue_Join(&value, NULL);
+
+	joined = __IniArena_Allocate(&file->arena, item->valueLength + 1);
+
+	if (!joined)
+		return NULL;
+
+	IniValue_Join(&value, joined);
+	joined[item->valueLength] = '\0';
+
+	item->value = joined;
+	item->spans = NULL;
+	item->spanCount = 0;
+
+	return item->value;
+}
+
+/* Turns parser callbacks into an IniFile. */
+typedef struct
+{
+	IniFile* file;
+
+	/* Section items are added to, NULL before the first section. */
+	size_t current;
+	bool inSection;
+
+	IniDuplicateKeys duplicateKeys;
+
+	/* Where repeated keys are recorded with IniDuplicate_Error, NULL to
+	 * fail the read instead. */
+	IniDiagnostics* diagnostics;
+
+	bool failed;
+} IniFileBuilder;
+
+static IniSection* __IniFile_FindSection(IniFile* file, const char* name,
+	size_t length)
+{
+	const IniIndex* index = &file->sectionIndex;
+	uint32_t hash = 0;
+	size_t i;
+
+	if (!index->capacity)
+		return NULL;
+
+	hash = __IniFile_HashSpan(name, length);
+	i = __IniIndex_Bucket(hash, index->capacity);
+
+	while (index->slots[i])
+	{
+		if (index->slots[i] != DM_INI_INDEX_TOMBSTONE)
+		{
+			IniSection* section = &file->sectionList[index->slots[i] - 1];
+
+			if (section->hash == hash &&
+				strncmp(section->name, name, length) == 0 &&
+				section->name[length] == '\0')
+			{
+				return section;
+			}
+		}
+
+		i = (i + 1) & (index->capacity - 1);
+	}
+
+	return NULL;
+}
+
+/* Adds the last section to the section index, growing it if needed. */
+static bool __IniFile_IndexLastSection(IniFile* file)
+{
+	IniIndex* index = &file->sectionIndex;
+
+	if ((index->count + 1) * 4 > index->capacity * 3)
+	{
+		size_t capacity = index->capacity ? index->capacity : 16;
+		uint32_t* slots = NULL;
+		size_t i;
+
+		while (file->sectionCount * 2 > capacity)
+			capacity *= 2;
+
+		slots = __IniAllocator_AllocateZeroed(&file->allocator,
+			capacity * sizeof(uint32_t));
+
+		if (!slots)
+		{
+			__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_MALLOC_FAIL, 10);
+
+			return false;
+		}
+
+		__IniAllocator_Free(&file->allocator, index->slots);
+
+		index->slots = slots;
+		index->capacity = capacity;
+		index->count = 0;
+
+		for (i = 0; i < file->sectionCount; ++i)
+			__IniIndex_Place(index, file->sectionList[i].hash, i);
+
+		return true;
+	}
+
+	__IniIndex_Place(index, file->sectionList[file->sectionCount - 1].hash,
+		file->sectionCount - 1);
+
+	return true;
+}
+
+/* Appends a section named name, which must be null terminated at length. */
+static IniSection* __IniFile_AddSection(IniFile* file, const char* name,
+	size_t length)
+{
+	IniSection* section = NULL;
+
+	if (file->sectionCount == file->sectionCapacity)
+	{
+		size_t capacity = file->sectionCapacity ? file->sectionCapacity * 2 : 8;
+		IniSection* sections = __IniAllocator_Reallocate(&file->allocator,
+			file->sectionList, capacity * sizeof(IniSection));
+
+		if (!sections)
+		{
+			__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_MALLOC_FAIL, 9);
+
+			return NULL;
+		}
+
+		file->sectionList = sections;
+		file->sectionCapacity = capacity;
+	}
+
+	section = &file->sectionList[file->sectionCount++];
+
+	memset(section, 0, sizeof(IniSection));
+	section->name = name;
+	section->hash = __IniFile_HashSpan(name, length);
+	section->allocator = &file->allocator;
+
+	if (!__IniFile_IndexLastSection(file))
+	{
+		file->sectionCount--;
+
+		return NULL;
+	}
+
+	file->tree.built = false;
+	file->sorted = false;
+
+	return section;
+}
+
+static bool __IniFileBuilder_OnSection(void* user, IniSpan name)
+{
+	IniFileBuilder* builder = (IniFileBuilder*)user;
+	IniFile* file = builder->file;
+	IniSection* section = NULL;
+
+	/* Spans point into our own buffer, so they can be terminated in place. */
+	((char*)name.data)[name.length] = '\0';
+
+	/* A reopened section is found through the index and carries on where
+	 * it left off, its items keep growing the same list. */
+	section = __IniFile_FindSection(file, name.data, name.length);
+
+	if (!section)
+		section = __IniFile_AddSection(file, name.data, name.length);
+
+	if (!section)
+	{
+		builder->failed = true;
+
+		return false;
+	}
+
+	builder->current = (size_t)(section - file->sectionList);
+	builder->inSection = true;
+
+	return true;
+}
+
+/* Points item at value, copying nothing unless it has to. */
+static bool __IniFile_StoreValue(IniFile* file, IniItem* item,
+	const IniValue* value)
+{
+	item->flags = value->flags;
+
+	if (value->spanCount == 1 && !(value->flags & DM_INI_VALUE_ESCAPED))
+	{
+		/* Terminated by __IniFile_TerminateValues() once parsing is done. */
+		item->value = value->spans[0].data;
+		item->valueLength = value->spans[0].length;
+	}
+	else
+	{
+		IniSpan* spans = __IniArena_Allocate(&file->arena,
+			value->spanCount * sizeof(IniSpan));
+
+		if (!spans)
+			return false;
+
+		memcpy(spans, value->spans, value->spanCount * sizeof(IniSpan));
+
+		item->spans = spans;
+		item->spanCount = value->spanCount;
+	}
+
+	return true;
+}
+
+static bool __IniFile_AppendElement(IniFile* file, IniItem* item,
+	IniSpan element)
+{
+	if (item->elementCount == item->elementCapacity)
+	{
+		size_t capacity = item->elementCapacity ? item->elementCapacity * 2 : 4;
+		IniSpan* elements = __IniArena_Allocate(&file->arena,
+			capacity * sizeof(IniSpan));
+
+		if (!elements)
+			return false;
+
+		if (item->elementCount)
+			memcpy(elements, item->elements, item->elementCount * sizeof(IniSpan));
+
+		item->elements = elements;
+		item->elementCapacity = capacity;
+	}
+
+	item->elements[item->elementCount++] = element;
+
+	return true;
+}
+
+/* Resolves value and adds it to the elements of an array item. */
+static bool __IniFile_AppendValue(IniFile* file, IniItem* item,
+	const IniValue* value)
+{
+	IniItem next;
+	IniSpan element;
+
+	memset(&next, 0, sizeof(next));
+
+	if (!__IniFile_StoreValue(file, &next, value) ||
+		!__IniFile_ResolveValue(file, &next))
+	{
+		return false;
+	}
+
+	element.data = next.value;
+	element.length = next.valueLength;
+
+	return __IniFile_AppendElement(file, item, element);
+}
+
+/* Turns a plain item into an array holding its value, for collecting. */
+static bool __IniFile_MakeArray(IniFile* file, IniItem* item)
+{
+	IniSpan element;
+
+	if (item->flags & DM_INI_VALUE_ARRAY)
+		return true;
+
+	if (!__IniFile_ResolveValue(file, item))
+		return false;
+
+	/* Elements split from the value would be stale now. */
+	item->elements = NULL;
+	item->elementCount = 0;
+	item->elementCapacity = 0;
+	item->flags |= DM_INI_VALUE_ARRAY;
+
+	element.data = item->value;
+	element.length = item->valueLength;
+
+	return __IniFile_AppendElement(file, item, element);
+}
+
+static bool __IniFileBuilder_OnItem(void* user, IniSpan key,
+	const IniValue* value)
+{
+	IniFileBuilder* builder = (IniFileBuilder*)user;
+	IniFile* file = builder->file;
+	IniSection* section = builder->inSection ?
+		&file->sectionList[builder->current] : &file->globalSection;
+	IniItem* item = NULL;
+	IniSpan element;
+	uint32_t hash = 0;
+	bool isArray = false;
+	bool found = false;
+
+	isArray = key.length >= 2 &&
+		key.data[key.length - 2] == DM_LEFT_BRACKET &&
+		key.data[key.length - 1] == DM_RIGHT_BRACKET;
+
+	if (isArray)
+		key.length -= 2;
+
+	hash = __IniFile_HashSpan(key.data, key.length);
+
+	/* Duplicates turn up here, in the same probe that adds new keys. */
+	item = __IniSection_FindOrAdd(section, key.data, key.length, hash, &found);
+
+	if (!item)
+	{
+		builder->failed = true;
+
+		return false;
+	}
+
+	if (found)
+	{
+		if (isArray && (item->flags & DM_INI_VALUE_ARRAY))
+		{
+			if (!__IniFile_AppendValue(file, item, value))
+			{
+				builder->failed = true;
+
+				return false;
+			}
+
+			return true;
+		}
+
+		switch (builder->duplicateKeys)
+		{
+		case IniDuplicate_LastWins:
+		{
+			const char* name = item->key;
+
+			/* Start over as if this were the first time the key was seen. */
+			memset(item, 0, sizeof(IniItem));
+			item->key = name;
+			item->keyLength = key.length;
+			item->hash = hash;
+			section->sorted = false;
+
+			break;
+		}
+		case IniDuplicate_Collect:
+			if (!__IniFile_MakeArray(file, item) ||
+				!__IniFile_AppendValue(file, item, value))
+			{
+				builder->failed = true;
+
+				return false;
+			}
+
+			return true;
+		case IniDuplicate_Error:
+			__IniFile_SetErrorHintAt(DM_INI_ERROR_MESSAGE_DUPLICATE_KEY,
+				DM_INI_ERROR_CODE_DUPLICATE_KEY, (size_t)(key.data - file->buffer));
+
+			/* Keep the first value and carry on. */
+			if (__IniDiagnostics_Add(builder->diagnostics, file->buffer,
+				file->bufferLength))
+			{
+				return true;
+			}
+
+			builder->failed = true;
+
+			return false;
+		default:
+			return true;
+		}
+	}
+	else
+	{
+		((char*)key.data)[key.length] = '\0';
+	}
+
+	if (!__IniFile_StoreValue(file, item, value))
+	{
+		builder->failed = true;
+
+		return false;
+	}
+
+	if (isArray)
+	{
+		/* Array elements are resolved up front, there is no raw form left. */
+		item->flags |= DM_INI_VALUE_ARRAY;
+
+		if (!__IniFile_ResolveValue(file, item))
+		{
+			builder->failed = true;
+
+			return false;
+		}
+
+		element.data = item->value;
+		element.length = item->valueLength;
+
+		if (!__IniFile_AppendElement(file, item, element))
+		{
+			builder->failed = true;
+
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Terminates the values that point into the buffer. Done after parsing
+ * rather than as they are stored, since the byte after a value is often the
+ * '\n' that error locations are counted from.
+ */
+static void __IniFile_TerminateValues(IniFile* file)
+{
+	size_t s;
+	size_t i;
+
+	for (s = 0; s <= file->sectionCount; ++s)
+	{
+		IniSection* section = s ? &file->sectionList[s - 1] :
+			&file->globalSection;
+
+		for (i = 0; i < section->itemCount; ++i)
+		{
+			IniItem* item = &section->itemList[i];
+
+			/* Spans point into our own buffer, so they can be terminated in
+			 * place. Joined values already are. */
+			if (item->value)
+				((char*)item->value)[item->valueLength] = '\0';
+		}
+	}
+}
+
+/*
+ * Builds an IniFile that takes ownership of buffer. Problems go into
+ * diagnostics instead of failing the build if it is not NULL.
+ */
+static IniFile* __IniFile_Build(char* buffer, size_t length,
+	const IniOptions* options, IniDiagnostics* diagnostics)
+{
+	IniFileBuilder builder;
+	IniHandler handler;
+	IniFile* file = NULL;
+	const IniAllocator* allocator = options ? options->allocator : NULL;
+
+	file = __IniAllocator_AllocateZeroed(allocator, sizeof(IniFile));
+
+	if (!file)
+	{
+		__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_MALLOC_FAIL, 11);
+
+		__IniAllocator_Free(allocator, buffer);
+
+		return NULL;
+	}
+
+	if (allocator)
+		file->allocator = *allocator;
+
+	file->globalSection.allocator = &file->allocator;
+	file->arena.allocator = &file->allocator;
+	file->tree.allocator = &file->allocator;
+
+	file->buffer = buffer;
+	file->bufferLength = length;
+
+	memset(&builder, 0, sizeof(builder));
+	builder.file = file;
+	builder.duplicateKeys = options ? options->duplicateKeys :
+		IniDuplicate_FirstWins;
+	builder.diagnostics = diagnostics;
+
+	handler.onSection = __IniFileBuilder_OnSection;
+	handler.onItem = __IniFileBuilder_OnItem;
+
+	if (!__IniFile_ParseWithDiagnostics(buffer, length, options, &handler,
+		&builder, diagnostics))
+	{
+		/* Keep whatever hint the parser or the builder left behind. */
+		IniErrorHint* hint = IniFile_GetErrorHint();
+		IniErrorHint saved = { NULL, 0, DM_INI_NO_OFFSET, 0, 0 };
+
+		if (hint)
+			saved = *hint;
+
+		IniFile_Free(file);
+
+		if (saved.errorText)
+			__IniFile_RestoreErrorHint(&saved);
+
+		return NULL;
+	}
+
+	__IniFile_TerminateValues(file);
+
+	return file;
+}
+
+/* Reads and builds filename, see __IniFile_Build() for diagnostics. */
+static IniFile* __IniFile_ReadFile(const char* filename,
+	const IniOptions* options, IniDiagnostics* diagnostics)
+{
+	FILE* fp = NULL;
+	char* buffer = NULL;
+	size_t length = 0;
+
+	__IniFile_ClearErrorHint();
+
+	fp = fopen(filename, "rb");
+
+	if (!fp)
+	{
+		__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_FOPEN_FAIL, errno);
+
+		return NULL;
+	}
+
+	buffer = __IniFile_ReadAll(fp, &length,
+		options ? options->allocator : NULL);
+
+	fclose(fp);
+
+	if (!buffer)
+		return NULL;
+
+	return __IniFile_Build(buffer, length, options, diagnostics);
+}
+
+IniFile* IniFile_ReadFileWithOptions(const char* filename,
+	const IniOptions* options)
+{
+	return __IniFile_ReadFile(filename, options, NULL);
+}
+
+IniFile* IniFile_ReadWithDiagnostics(const char* filename,
+	const IniOptions* options, IniDiagnostics* diagnostics)
+{
+	if (!diagnostics)
+		return __IniFile_ReadFile(filename, options, NULL);
+
+	memset(diagnostics, 0, sizeof(IniDiagnostics));
+
+	if (options && options->allocator)
+		diagnostics->allocator = *options->allocator;
+
+	return __IniFile_ReadFile(filename, options, diagnostics);
+}
+
+IniFile* IniFile_ReadBuffer(const char* data, size_t length,
+	const IniOptions* options)
+{
+	const IniAllocator* allocator = options ? options->allocator : NULL;
+	char* buffer = NULL;
+	size_t decodedLength = 0;
+
+	__IniFile_ClearErrorHint();
+
+	if (!__IniFile_DecodeUtf16(data, length, allocator, &buffer,
+		&decodedLength))
+	{
+		return NULL;
+	}
+
+	if (buffer)
+		return __IniFile_Build(buffer, decodedLength, options, NULL);
+
+	buffer = __IniAllocator_Allocate(allocator, length + 1);
+
+	if (!buffer)
+	{
+		__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_MALLOC_FAIL, 7);
+
+		return NULL;
+	}
+
+	if (length)
+		memcpy(buffer, data, length);
+
+	buffer[length] = '\0';
+
+	return __IniFile_Build(buffer, length, options, NULL);
+}
+
+void IniFile_Free(IniFile* file)
+{
+	IniAllocator allocator;
+	size_t i;
+
+	if (!file) return;
+
+	/* The file itself came from the allocator, so keep a copy to free it. */
+	allocator = file->allocator;
+
+	__IniSection_Release(&file->globalSection);
+
+	for (i = 0; i < file->sectionCount; ++i)
+	{
+		__IniSection_Release(&file->sectionList[i]);
+	}
+
+	__IniAllocator_Free(&allocator, file->sectionList);
+	__IniAllocator_Free(&allocator, file->sectionIndex.slots);
+
+	__IniTree_Release(&file->tree);
+
+	__IniAllocator_Free(&allocator, file->sortedSections);
+
+	__IniArena_Free(&file->arena);
+
+	__IniAllocator_Free(&allocator, file->buffer);
+
+	__IniAllocator_Free(&allocator, file);
+}
+
+IniSection* IniFile_GetSection(IniFile* file, const char* name)
+{
+	if (!file) return NULL;
+
+	if (!name)
+		return &file->globalSection;
+
+	return __IniFile_FindSection(file, name, strlen(name));
+}
+
+size_t IniFile_SectionCount(const IniFile* file)
+{
+	if (!file) return 0;
+
+	return file->sectionCount;
+}
+
+IniSection* IniFile_SectionAt(IniFile* file, size_t index)
+{
+	if (!file || index >= file->sectionCount)
+		return NULL;
+
+	return &file->sectionList[index];
+}
+
+IniItem* IniFile_GetItem(IniFile* file, const char* section, const char* key)
+{
+	IniSection* found = IniFile_GetSection(file, section);
+	size_t keyLength = 0;
+
+	if (!found || !key)
+		return NULL;
+
+	keyLength = strlen(key);
+
+	return __IniSection_Find(found, key, keyLength,
+		__IniFile_HashSpan(key, keyLength));
+}
+
+IniKey IniKey_Make(const char* data, size_t length)
+{
+	IniKey key;
+
+	key.data = data;
+	key.length = length;
+	key.hash = __IniFile_HashSpan(data, length);
+
+	return key;
+}
+
+IniSection* IniFile_FindSection(IniFile* file, const char* name,
+	size_t length)
+{
+	if (!file) return NULL;
+
+	if (!name)
+		return &file->globalSection;
+
+	return __IniFile_FindSection(file, name, length);
+}
+
+IniItem* IniSection_Find(IniSection* section, const IniKey* key)
+{
+	if (!section || !key)
+		return NULL;
+
+	return __IniSection_Find(section, key->data, key->length, key->hash);
+}
+
+const char* IniFile_GetItemValue(IniFile* file, IniItem* item)
+{
+	if (!file || !item)
+		return NULL;
+
+	return __IniFile_ResolveValue(file, item);
+}
+
+const char* IniFile_GetValue(IniFile* file, const char* section,
+	const char* key)
+{
+	IniItem* item = IniFile_GetItem(file, section, key);
+
+	if (!item)
+		return NULL;
+
+	return __IniFile_ResolveValue(file, item);
+}
+
+/* Editing */
+
+static char* __IniFile_CopyString(IniFile* file, const char* text,
+	size_t length)
+{
+	char* copy = __IniArena_Allocate(&file->arena, length + 1);
+
+	if (!copy)
+		return NULL;
+
+	memcpy(copy, text, length);
+	copy[length] = '\0';
+
+	return copy;
+}
+
+IniSection* IniFile_AddSection(IniFile* file, const char* name)
+{
+	IniSection* section = NULL;
+	size_t length = 0;
+	char* copy = NULL;
+
+	if (!file) return NULL;
+
+	if (!name)
+		return &file->globalSection;
+
+	length = strlen(name);
+	section = __IniFile_FindSection(file, name, length);
+
+	if (section)
+		return section;
+
+	copy = __IniFile_CopyString(file, name, length);
+
+	if (!copy)
+		return NULL;
+
+	return __IniFile_AddSection(file, copy, length);
+}
+
+IniItem* IniFile_Set(IniFile* file, const char* section, const char* key,
+	const char* value)
+{
+	IniSection* found = NULL;
+	IniItem* item = NULL;
+	size_t keyLength = 0;
+	size_t valueLength = 0;
+	uint32_t hash = 0;
+	char* copy = NULL;
+
+	if (!file || !key || !value)
+		return NULL;
+
+	found = IniFile_AddSection(file, section);
+
+	if (!found)
+		return NULL;
+
+	keyLength = strlen(key);
+	valueLength = strlen(value);
+	hash = __IniFile_HashSpan(key, keyLength);
+
+	item = __IniSection_Find(found, key, keyLength, hash);
+
+	if (item && item->value && !item->elements &&
+		valueLength <= item->valueLength)
+	{
+		/* Both the buffer and the arena are ours, so overwrite in place. */
+		memmove((char*)item->value, value, valueLength + 1);
+
+		item->valueLength = valueLength;
+		item->flags = 0;
+
+		return item;
+	}
+
+	copy = __IniFile_CopyString(file, value, valueLength);
+
+	if (!copy)
+		return NULL;
+
+	if (!item)
+	{
+		char* keyCopy = __IniFile_CopyString(file, key, keyLength);
+
+		if (!keyCopy)
+			return NULL;
+
+		item = __IniSection_AddItem(found, keyCopy, keyLength, hash);
+
+		if (!item)
+			return NULL;
+	}
+
+	item->value = copy;
+	item->valueLength = valueLength;
+	item->spans = NULL;
+	item->spanCount = 0;
+	item->flags = 0;
+	item->elements = NULL;
+	item->elementCount = 0;
+	item->elementCapacity = 0;
+
+	return item;
+}
+
+bool IniFile_Remove(IniFile* file, const char* section, const char* key)
+{
+	IniSection* found = IniFile_GetSection(file, section);
+	IniItem* item = NULL;
+	size_t keyLength = 0;
+
+	if (!found || !key)
+		return false;
+
+	keyLength = strlen(key);
+	item = __IniSection_Find(found, key, keyLength,
+		__IniFile_HashSpan(key, keyLength));
+
+	if (!item)
+		return false;
+
+	__IniSection_RemoveItem(found, item);
+
+	return true;
+}
+
+bool IniFile_RemoveSection(IniFile* file, const char* name)
+{
+	IniIndex* index = NULL;
+	IniSection* section = NULL;
+	size_t position = 0;
+	size_t last = 0;
+
+	if (!file || !name)
+		return false;
+
+	section = __IniFile_FindSection(file, name, strlen(name));
+
+	if (!section)
+		return false;
+
+	index = &file->sectionIndex;
+	position = (size_t)(section - file->sectionList);
+	last = file->sectionCount - 1;
+
+	index->slots[__IniIndex_Slot(index, section->hash, position)] =
+		DM_INI_INDEX_TOMBSTONE;
+
+	__IniSection_Release(section);
+
+	if (position != last)
+	{
+		*section = file->sectionList[last];
+
+		index->slots[__IniIndex_Slot(index, section->hash, last)] =
+			(uint32_t)position + 1;
+	}
+
+	file->sectionCount--;
+	file->tree.built = false;
+	file->sorted = false;
+
+	return true;
+}
+
+bool __IniFile_ReadLine(const char* line, IniItem* item, IniItem* section)
+{
+	return false;
+}
+
+/* Byte classes used by the line classifier. */
+enum
+{
+	INI_CLASS_OTHER = 0,
+	INI_CLASS_SPACE,
+	INI_CLASS_NEWLINE,
+	INI_CLASS_COMMENT,
+	INI_CLASS_SLASH,
+	INI_CLASS_SECTION,
+	INI_CLASS_SEPARATOR
+};
+
+static const char __IniFile_DefaultComments[] =
+	{ DM_INI_COMMENT_1, DM_INI_COMMENT_2, 0 };
+
+/* The default dialect, compiled by hand so that it needs no setup. */
+static const IniDialect __IniFile_DefaultDialect =
+{
+	__IniFile_DefaultComments, "=", " \t\v\f", DM_LEFT_BRACKET, DM_RIGHT_BRACKET,
+	true, false,
+	{
+		[' '] = INI_CLASS_SPACE,
+		['\t'] = INI_CLASS_SPACE,
+		['\v'] = INI_CLASS_SPACE,
+		['\f'] = INI_CLASS_SPACE,
+		['\r'] = INI_CLASS_NEWLINE,
+		['\n'] = INI_CLASS_NEWLINE,
+		[DM_INI_COMMENT_1] = INI_CLASS_COMMENT,
+		[DM_INI_COMMENT_2] = INI_CLASS_COMMENT,
+		[DM_INI_COMMENT_3] = INI_CLASS_SLASH,
+		[DM_LEFT_BRACKET] = INI_CLASS_SECTION,
+		['='] = INI_CLASS_SEPARATOR
+	},
+	'=', true
+};
+
+#define INI_CLASS_OF(dialect, c) ((dialect)->classes[(unsigned char)(c)])
+#define INI_CHAR_CLASS(c) INI_CLASS_OF(&__IniFile_DefaultDialect, c)
+
+void IniDialect_SetDefaults(IniDialect* dialect)
+{
+	if (!dialect) return;
+
+	*dialect = __IniFile_DefaultDialect;
+}
+
+/* Gives each of chars the class type, unless one already has a meaning. */
+static bool __IniDialect_Assign(IniDialect* dialect, const char* chars,
+	unsigned char type)
+{
+	for (; chars && *chars; ++chars)
+	{
+		if (INI_CLASS_OF(dialect, *chars) != INI_CLASS_OTHER)
+			return false;
+
+		dialect->classes[(unsigned char)*chars] = type;
+	}
+
+	return true;
+}
+
+bool IniDialect_Compile(IniDialect* dialect)
+{
+	const char slash[] = { DM_INI_COMMENT_3, 0 };
+	const char open[] = { dialect ? dialect->sectionOpen : 0, 0 };
+
+	if (!dialect) return false;
+
+	memset(dialect->classes, INI_CLASS_OTHER, sizeof(dialect->classes));
+	dialect->classes['\r'] = INI_CLASS_NEWLINE;
+	dialect->classes['\n'] = INI_CLASS_NEWLINE;
+
+	if (!dialect->separators || !dialect->separators[0] ||
+		!dialect->sectionOpen || !dialect->sectionClose ||
+		INI_CLASS_OF(dialect, dialect->sectionClose) == INI_CLASS_NEWLINE ||
+		!__IniDialect_Assign(dialect, dialect->whitespace, INI_CLASS_SPACE) ||
+		!__IniDialect_Assign(dialect, dialect->commentPrefixes,
+			INI_CLASS_COMMENT) ||
+		!__IniDialect_Assign(dialect, dialect->slashComments ? slash : NULL,
+			INI_CLASS_SLASH) ||
+		!__IniDialect_Assign(dialect, open, INI_CLASS_SECTION) ||
+		!__IniDialect_Assign(dialect, dialect->separators, INI_CLASS_SEPARATOR))
+	{
+		__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_BAD_DIALECT,
+			DM_INI_ERROR_CODE_BAD_DIALECT);
+
+		return false;
+	}
+
+	dialect->separator = dialect->separators[1] ? 0 : dialect->separators[0];
+	dialect->wideSpace = INI_CLASS_OF(dialect, ' ') == INI_CLASS_SPACE &&
+		INI_CLASS_OF(dialect, '\t') == INI_CLASS_SPACE;
+
+	return true;
+}
+
+static size_t __IniFile_SkipWhitespace(const IniDialect* dialect,
+	const char* text, size_t length)
+{
+	size_t i = 0;
+
+	/* Most lines are not indented at all. */
+	if (length == 0 || INI_CLASS_OF(dialect, text[0]) != INI_CLASS_SPACE)
+		return 0;
+
+#if DM_INI_USE_SSE2
+	if (dialect->wideSpace)
+	{
+		const __m128i space = _mm_set1_epi8(' ');
+		const __m128i tab = _mm_set1_epi8('\t');
+
+		while (i + 16 <= length)
+		{
+			__m128i chunk = _mm_loadu_si128((const __m128i*)(text + i));
+			unsigned int mask = (unsigned int)_mm_movemask_epi8(
+				_mm_or_si128(_mm_cmpeq_epi8(chunk, space),
+					_mm_cmpeq_epi8(chunk, tab)));
+
+			if (mask != 0xFFFF)
+			{
+				i += __IniFile_CountTrailingZeros(~mask & 0xFFFF);
+				break;
+			}
+
+			i += 16;
+		}
+	}
+#endif
+
+	while (i < length && INI_CLASS_OF(dialect, text[i]) == INI_CLASS_SPACE)
+		++i;
+
+	return i;
+}
+
+static IniLineType __IniFile_ClassifyLineWith(const IniDialect* dialect,
+	const char* line, size_t length, IniLineInfo* info)
+{
+	IniLineType type = IniLine_Blank;
+	size_t begin = 0;
+	size_t end = 0;
+
+	if (!line)
+		length = 0;
+
+	begin = __IniFile_SkipWhitespace(dialect, line, length);
+	end = length;
+
+	while (end > begin &&
+		(INI_CLASS_OF(dialect, line[end - 1]) == INI_CLASS_SPACE ||
+		INI_CLASS_OF(dialect, line[end - 1]) == INI_CLASS_NEWLINE))
+	{
+		--end;
+	}
+
+	if (begin < end)
+	{
+		switch (INI_CLASS_OF(dialect, line[begin]))
+		{
+		case INI_CLASS_COMMENT:
+			type = IniLine_Comment;
+			break;
+		case INI_CLASS_SLASH:
+			if (begin + 1 < end && line[begin + 1] == DM_INI_COMMENT_3)
+				type = IniLine_Comment;
+			else if (begin + 1 < end && line[begin + 1] == DM_INI_COMMENT_4)
+				type = IniLine_BlockComment;
+			else
+				type = begin > 0 ? IniLine_Continuation : IniLine_Item;
+			break;
+		case INI_CLASS_SECTION:
+			type = IniLine_Section;
+			break;
+		default:
+			type = begin > 0 ? IniLine_Continuation : IniLine_Item;
+			break;
+		}
+	}
+	else
+	{
+		begin = end;
+	}
+
+	if (info)
+	{
+		info->type = type;
+		info->begin = begin;
+		info->end = end;
+	}
+
+	return type;
+}
+
+IniLineType __IniFile_ClassifyLine(const char* line, size_t length,
+	IniLineInfo* info)
+{
+	return __IniFile_ClassifyLineWith(&__IniFile_DefaultDialect, line, length,
+		info);
+}
+
+bool __IniFile_IsLineCommented(const char* line)
+{
+	IniLineType type;
+
+	if (!line)
+		return false;
+
+	/* For simplicity's sake, we consider a blank line a comment. */
+	type = __IniFile_ClassifyLine(line, strlen(line), NULL);
+
+	return (type == IniLine_Blank || type == IniLine_Comment ||
+		type == IniLine_BlockComment);
+}
+
+bool __IniFile_IsBeginBlockComment(const char* line)
+{
+	return (line && line[0] == DM_INI_COMMENT_3 &&
+		line[1] == DM_INI_COMMENT_4);
+}
+
+bool __IniFile_IsEndBlockComment(const char* line)
+{
+	static const char terminator[] = { DM_INI_COMMENT_4, DM_INI_COMMENT_3, 0 };
+
+	if (!line)
+		return false;
+
+	return strstr(line, terminator) != NULL;
+}
+
+void __IniParser_Initialize(IniParser* parser, const IniOptions* options)
+{
+	IniOptions defaults;
+
+	if (!parser) return;
+
+	if (!options)
+	{
+		IniOptions_SetDefaults(&defaults);
+		options = &defaults;
+	}
+
+	parser->commentDepth = 0;
+	parser->commentStart = NULL;
+	parser->commentHighBit = 0;
+	parser->nestedComments = options->nestedComments;
+	parser->lineContinuation = options->lineContinuation;
+	parser->indentedContinuation = options->indentedContinuation;
+	parser->skipBom = options->skipBom;
+	parser->validateUtf8 = options->validateUtf8;
+	parser->dialect = options->dialect ? options->dialect :
+		&__IniFile_DefaultDialect;
+	parser->diagnostics = NULL;
+	parser->spans = NULL;
+	parser->spanCapacity = 0;
+	parser->allocator = options->allocator;
+}
+
+void __IniParser_Release(IniParser* parser)
+{
+	if (!parser) return;
+
+	__IniAllocator_Free(parser->allocator, parser->spans);
+
+	parser->spans = NULL;
+	parser->spanCapacity = 0;
+}
+
+/*
+ * Finds the block comment terminator, returns length if there is none.
+ * *highBit is set to where a UTF-8 check of the comment has to start: the
+ * first byte with the high bit set, or the first byte the vector loop did
+ * not look at.
+ */
+static size_t __IniFile_FindBlockCommentEnd(const char* text, size_t length,
+	size_t* highBit)
+{
+	size_t i = 0;
+
+	*highBit = length;
+
+#if DM_INI_USE_SSE2
+	{
+		const __m128i star = _mm_set1_epi8(DM_INI_COMMENT_4);
+		const __m128i slash = _mm_set1_epi8(DM_INI_COMMENT_3);
+
+		/* Compare each byte with '*' and the byte after it with '/'. */
+		while (i + 17 <= length)
+		{
+			__m128i first = _mm_loadu_si128((const __m128i*)(text + i));
+			__m128i second = _mm_loadu_si128((const __m128i*)(text + i + 1));
+			unsigned int mask = (unsigned int)_mm_movemask_epi8(
+				_mm_and_si128(_mm_cmpeq_epi8(first, star),
+					_mm_cmpeq_epi8(second, slash)));
+			unsigned int high = (unsigned int)_mm_movemask_epi8(first);
+
+			if (high && *highBit == length)
+				*highBit = i + __IniFile_CountTrailingZeros(high);
+
+			if (mask)
+			{
+				i += __IniFile_CountTrailingZeros(mask);
+
+				if (*highBit > i)
+					*highBit = i;
+
+				return i;
+			}
+
+			i += 16;
+		}
+	}
+#endif
+
+	if (*highBit > i)
+		*highBit = i;
+
+	while (i + 1 < length)
+	{
+		const char* found = memchr(text + i, DM_INI_COMMENT_4, length - i - 1);
+
+		if (!found)
+			break;
+
+		i = (size_t)(found - text);
+
+		if (text[i + 1] == DM_INI_COMMENT_3)
+			return i;
+
+		++i;
+	}
+
+	return length;
+}
+
+size_t __IniParser_SkipBlockComment(IniParser* parser, const char* text,
+	size_t length)
+{
+	size_t i = 0;
+
+	/* Nested comments are walked with memchr(), which sees no high bits. */
+	parser->commentHighBit = 0;
+
+	if (parser->commentDepth > 0 && !parser->nestedComments)
+	{
+		i = __IniFile_FindBlockCommentEnd(text, length,
+			&parser->commentHighBit);
+
+		if (i == length)
+			return length;
+
+		parser->commentDepth = 0;
+
+		return i + 2;
+	}
+
+	while (parser->commentDepth > 0 && i < length)
+	{
+		const char* star = memchr(text + i, DM_INI_COMMENT_4, length - i);
+		size_t at = 0;
+
+		if (!star)
+			return length;
+
+		at = (size_t)(star - text);
+
+		/* The slash has to belong to this scan, not to a terminator. */
+		if (parser->nestedComments && at > i &&
+			text[at - 1] == DM_INI_COMMENT_3)
+		{
+			parser->commentDepth++;
+			i = at + 1;
+		}
+		else if (at + 1 < length && text[at + 1] == DM_INI_COMMENT_3)
+		{
+			parser->commentDepth--;
+			i = at + 2;
+		}
+		else
+		{
+			i = at + 1;
+		}
+	}
+
+	return i;
+}
+
+IniLineType __IniParser_ClassifyLine(IniParser* parser, const char* line,
+	size_t length, IniLineInfo* info)
+{
+	IniLineInfo local;
+	IniLineType type = IniLine_Blank;
+	size_t offset = 0;
+
+	if (!info)
+		info = &local;
+
+	if (!line)
+		length = 0;
+
+	for (;;)
+	{
+		if (parser->commentDepth > 0)
+		{
+			offset += __IniParser_SkipBlockComment(parser, line + offset,
+				length - offset);
+
+			if (parser->commentDepth > 0)
+			{
+				info->type = IniLine_Comment;
+				info->begin = info->end = length;
+
+				return IniLine_Comment;
+			}
+		}
+
+		type = __IniFile_ClassifyLineWith(parser->dialect, line + offset,
+			length - offset, info);
+
+		if (type != IniLine_BlockComment)
+			break;
+
+		parser->commentDepth = 1;
+		parser->commentStart = line + offset + info->begin;
+		offset += info->begin + 2;
+	}
+
+	info->begin += offset;
+	info->end += offset;
+
+	if (offset > 0)
+	{
+		/* Whatever follows a comment is never a continuation. */
+		if (type == IniLine_Blank)
+			type = IniLine_Comment;
+		else if (type == IniLine_Continuation)
+			type = IniLine_Item;
+
+		info->type = type;
+	}
+
+	return type;
+}
+
+bool __IniFile_IsSectionDeclaration(const char* line)
+{
+	size_t len = 0;
+
+	if (!line)
+		return false;
+
+	len = strlen(line) - 1;
+
+	return (line[0] == DM_LEFT_BRACKET && line[len] == DM_RIGHT_BRACKET);
+}
+
+char* __IniFile_GetSectionName(const char* line)
+{
+	size_t len = 0;
+
+	if (!line)
+		return false;
+
+	len = strlen(line) - 1;
+
+	if (!(line[0] == DM_LEFT_BRACKET && line[len] == DM_RIGHT_BRACKET))
+		return NULL;
+
+	return substring(line, 1, len - 1);
+}
+
+/* Trims the dialect's whitespace from both ends of [begin, end). */
+static IniSpan __IniFile_TrimSpanWith(const IniDialect* dialect,
+	const char* text, size_t begin, size_t end)
+{
+	IniSpan span;
+
+	while (begin < end && INI_CLASS_OF(dialect, text[begin]) == INI_CLASS_SPACE)
+		++begin;
+
+	while (end > begin && INI_CLASS_OF(dialect, text[end - 1]) == INI_CLASS_SPACE)
+		--end;
+
+	span.data = text + begin;
+	span.length = end - begin;
+
+	return span;
+}
+
+/* Trims spaces and tabs from both ends of [begin, end). */
+static IniSpan __IniFile_TrimSpan(const char* text, size_t begin, size_t end)
+{
+	return __IniFile_TrimSpanWith(&__IniFile_DefaultDialect, text, begin, end);
+}
+
+/* Finds the first separator in an item line. */
+static const char* __IniParser_FindSeparator(const IniParser* parser,
+	const char* text, size_t length)
+{
+	const IniDialect* dialect = parser->dialect;
+	size_t i;
+
+	/* One separator, as in almost every dialect, is a plain memchr. */
+	if (dialect->separator)
+		return memchr(text, dialect->separator, length);
+
+	for (i = 0; i < length; ++i)
+	{
+		if (INI_CLASS_OF(dialect, text[i]) == INI_CLASS_SEPARATOR)
+			return text + i;
+	}
+
+	return NULL;
+}
+
+/*
+ * Drops an inline comment from an unquoted value when the dialect has them.
+ * A comment prefix only counts after whitespace, so "a;b" stays whole.
+ */
+static void __IniParser_CutComment(const IniParser* parser, IniSpan* span)
+{
+	const IniDialect* dialect = parser->dialect;
+	size_t i;
+
+	if (!dialect->inlineComments)
+		return;
+
+	/* The byte before a span is always part of the buffer. */
+	for (i = 0; i < span->length; ++i)
+	{
+		if (INI_CLASS_OF(dialect, span->data[i]) == INI_CLASS_COMMENT &&
+			INI_CLASS_OF(dialect, *(span->data + i - 1)) == INI_CLASS_SPACE)
+		{
+			*span = __IniFile_TrimSpanWith(dialect, span->data, 0, i);
+
+			return;
+		}
+	}
+}
+
+static bool __IniParser_PushSpan(IniParser* parser, size_t* count,
+	IniSpan span)
+{
+	if (*count == parser->spanCapacity)
+	{
+		size_t capacity = parser->spanCapacity ? parser->spanCapacity * 2 : 8;
+		IniSpan* spans = __IniAllocator_Reallocate(parser->allocator,
+			parser->spans, capacity * sizeof(IniSpan));
+
+		if (!spans)
+		{
+			__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_MALLOC_FAIL, 9);
+
+			return false;
+		}
+
+		parser->spans = spans;
+		parser->spanCapacity = capacity;
+	}
+
+	parser->spans[(*count)++] = span;
+
+	return true;
+}
+
+/* Whether span ends in a continuation backslash, which is dropped if so. */
+static bool __IniParser_TakeBackslash(const IniParser* parser, IniSpan* span)
+{
+	if (!parser->lineContinuation || span->length == 0 ||
+		span->data[span->length - 1] != DM_INI_LINE_CONTINUATION)
+	{
+		return false;
+	}
+
+	span->length--;
+
+	return true;
+}
+
+/*
+ * Strips the quotes from a quoted value and flags any escapes inside it.
+ * Returns false with the error hint set if the value is malformed, at an
+ * offset from buffer.
+ */
+static bool __IniParser_TakeQuotes(const IniParser* parser, IniSpan* span,
+	unsigned int* flags, const char* buffer)
+{
+	const char* text = span->data + 1;
+	size_t length = span->length - 1;
+	size_t at = 0;
+	size_t rest = 0;
+
+	for (;;)
+	{
+		const char* quote = memchr(text + at, DM_INI_QUOTE, length - at);
+		size_t slashes = 0;
+
+		if (!quote)
+		{
+			__IniFile_SetErrorHintAt(DM_INI_ERROR_MESSAGE_UNTERMINATED_QUOTE,
+				DM_INI_ERROR_CODE_UNTERMINATED_QUOTE,
+				(size_t)(span->data - buffer));
+
+			return false;
+		}
+
+		at = (size_t)(quote - text);
+
+		while (slashes < at && text[at - slashes - 1] == '\\')
+			++slashes;
+
+		if (slashes % 2 == 0)
+			break;
+
+		++at;
+	}
+
+	/* Only whitespace or a comment may follow the closing quote. */
+	rest = at + 1;
+
+	while (rest < length &&
+		INI_CLASS_OF(parser->dialect, text[rest]) == INI_CLASS_SPACE)
+	{
+		++rest;
+	}
+
+	if (rest < length &&
+		INI_CLASS_OF(parser->dialect, text[rest]) != INI_CLASS_COMMENT)
+	{
+		__IniFile_SetErrorHintAt(DM_INI_ERROR_MESSAGE_BAD_QUOTE,
+			DM_INI_ERROR_CODE_BAD_QUOTE, (size_t)(text + rest - buffer));
+
+		return false;
+	}
+
+	*flags = DM_INI_VALUE_QUOTED;
+
+	if (memchr(text, '\\', at))
+		*flags |= DM_INI_VALUE_ESCAPED;
+
+	span->data = text;
+	span->length = at;
+
+	return true;
+}
+
+/* Measures the valid UTF-8 at the start of text, stopping at the first bad
+ * sequence. */
+static size_t __IniFile_ValidUtf8Length(const char* text, size_t length)
+{
+	const unsigned char* bytes = (const unsigned char*)text;
+	size_t i = 0;
+
+	while (i < length)
+	{
+		unsigned char c = 0;
+		unsigned char low = 0x80;
+		unsigned char high = 0xBF;
+		size_t need = 0;
+		size_t k;
+
+#if DM_INI_USE_SSE2
+		/* Plain ASCII is the common case, 16 bytes at a time. */
+		while (i + 16 <= length)
+		{
+			unsigned int mask = (unsigned int)_mm_movemask_epi8(
+				_mm_loadu_si128((const __m128i*)(bytes + i)));
+
+			if (mask)
+			{
+				i += __IniFile_CountTrailingZeros(mask);
+				break;
+			}
+
+			i += 16;
+		}
+
+		if (i == length)
+			break;
+#endif
+
+		c = bytes[i];
+
+		if (c < 0x80)
+		{
+			++i;
+			continue;
+		}
+
+		/* Narrowing the second byte rules out overlong forms, surrogates
+		 * and anything past U+10FFFF. */
+		if (c >= 0xC2 && c <= 0xDF)
+			need = 1;
+		else if (c == 0xE0)
+			need = 2, low = 0xA0;
+		else if (c == 0xED)
+			need = 2, high = 0x9F;
+		else if (c >= 0xE1 && c <= 0xEF)
+			need = 2;
+		else if (c == 0xF0)
+			need = 3, low = 0x90;
+		else if (c == 0xF4)
+			need = 3, high = 0x8F;
+		else if (c >= 0xF1 && c <= 0xF3)
+			need = 3;
+		else
+			return i;
+
+		if (length - i <= need || bytes[i + 1] < low || bytes[i + 1] > high)
+			return i;
+
+		for (k = 2; k <= need; ++k)
+		{
+			if ((bytes[i + k] & 0xC0) != 0x80)
+				return i;
+		}
+
+		i += need + 1;
+	}
+
+	return length;
+}
+
+/*
+ * Measures the line at offset from buffer. When the parser validates UTF-8
+ * the same scan notes in *highBit where the first byte with the high bit set
+ * is, or the line length if there is none, so that the check can start there
+ * and a plain ASCII line is not read twice.
+ */
+static size_t __IniParser_LineLength(const IniParser* parser,
+	const char* buffer, size_t offset, size_t length, size_t* highBit)
+{
+	const char* text = buffer + offset;
+	size_t i = 0;
+	size_t high = 0;
+
+	length -= offset;
+
+	if (!parser->validateUtf8)
+	{
+		const char* newline = memchr(text, '\n', length);
+
+		*highBit = 0;
+
+		return newline ? (size_t)(newline - text) + 1 : length;
+	}
+
+	high = length;
+
+#if DM_INI_USE_SSE2
+	{
+		const __m128i newline = _mm_set1_epi8('\n');
+
+		/* One load gives both the newline and the high bit masks. */
+		while (i + 16 <= length)
+		{
+			__m128i bytes = _mm_loadu_si128((const __m128i*)(text + i));
+			unsigned int found = (unsigned int)_mm_movemask_epi8(
+				_mm_cmpeq_epi8(bytes, newline));
+			unsigned int mask = (unsigned int)_mm_movemask_epi8(bytes);
+
+			if (mask && high == length)
+				high = i + __IniFile_CountTrailingZeros(mask);
+
+			if (found)
+			{
+				i += __IniFile_CountTrailingZeros(found);
+				break;
+			}
+
+			i += 16;
+		}
+	}
+#endif
+
+	for (; i < length && text[i] != '\n'; ++i)
+	{
+		if ((unsigned char)text[i] >= 0x80 && high == length)
+			high = i;
+	}
+
+	if (i < length)
+		++i;
+
+	*highBit = high < i ? high : i;
+
+	return i;
+}
+
+/*
+ * Checks text at offset from buffer when the parser validates UTF-8.
+ * Returns false with the error hint set at the first bad sequence.
+ */
+static bool __IniParser_CheckUtf8(const IniParser* parser, const char* buffer,
+	size_t offset, size_t length)
+{
+	size_t valid = 0;
+
+	if (!parser->validateUtf8)
+		return true;
+
+	valid = __IniFile_ValidUtf8Length(buffer + offset, length);
+
+	if (valid == length)
+		return true;
+
+	__IniFile_SetErrorHintAt(DM_INI_ERROR_MESSAGE_BAD_UTF8,
+		DM_INI_ERROR_CODE_BAD_UTF8, offset + valid);
+
+	return false;
+}
+
+/* Where parsing starts, past a byte order mark if it is to be skipped. */
+static size_t __IniParser_Start(const IniParser* parser, const char* buffer,
+	size_t length)
+{
+	if (parser->skipBom && length >= 3 &&
+		(unsigned char)buffer[0] == 0xEF && (unsigned char)buffer[1] == 0xBB &&
+		(unsigned char)buffer[2] == 0xBF)
+	{
+		return 3;
+	}
+
+	return 0;
+}
+
+/*
+ * Collects the lines that continue a value starting with first. Leaves
+ * *position after the last line used and returns the number of spans in
+ * parser->spans, or 0 if memory ran out.
+ */
+static size_t __IniParser_CollectValue(IniParser* parser, const char* buffer,
+	size_t length, size_t* position, IniSpan first, bool backslash)
+{
+	size_t count = 0;
+
+	if (!__IniParser_PushSpan(parser, &count, first))
+		return 0;
+
+	while (*position < length)
+	{
+		const char* line = buffer + *position;
+		size_t highBit = 0;
+		size_t lineLength = __IniParser_LineLength(parser, buffer, *position,
+			length, &highBit);
+		IniLineInfo info;
+		IniLineType type = __IniFile_ClassifyLineWith(parser->dialect, line,
+			lineLength, &info);
+		IniSpan span;
+
+		/* After a backslash the next line is part of the value, whatever it
+		 * looks like. Otherwise only indented lines are. */
+		if (!backslash && !(parser->indentedContinuation &&
+			type == IniLine_Continuation))
+		{
+			break;
+		}
+
+		if (!__IniParser_CheckUtf8(parser, buffer, *position + highBit,
+			lineLength - highBit))
+		{
+			/* Recovering drops the bad line and ends the value there. */
+			if (!__IniDiagnostics_Add(parser->diagnostics, buffer, length))
+				return 0;
+
+			*position += lineLength;
+
+			break;
+		}
+
+		*position += lineLength;
+
+		span.data = line + info.begin;
+		span.length = info.end - info.begin;
+
+		__IniParser_CutComment(parser, &span);
+		backslash = __IniParser_TakeBackslash(parser, &span);
+
+		if (!__IniParser_PushSpan(parser, &count, span))
+			return 0;
+	}
+
+	return count;
+}
+
+static bool __IniParser_Run(IniParser* parser, const char* buffer,
+	size_t length, const IniHandler* handler, void* user)
+{
+	static const IniHandler emptyHandler = { NULL, NULL };
+	IniLineInfo info;
+	IniLineType type;
+	size_t position = __IniParser_Start(parser, buffer, length);
+	bool afterComment = false;
+
+	if (!handler)
+		handler = &emptyHandler;
+
+	while (position < length)
+	{
+		const char* line = buffer + position;
+		size_t highBit = 0;
+		size_t lineLength = __IniParser_LineLength(parser, buffer, position,
+			length, &highBit);
+
+		/* Only a line with a high bit set is read again, from that byte. A
+		 * sequence never spans lines since '\n' is ASCII. */
+		if (!__IniParser_CheckUtf8(parser, buffer, position + highBit,
+			lineLength - highBit))
+		{
+			if (!__IniDiagnostics_Add(parser->diagnostics, buffer, length))
+				return false;
+
+			position += lineLength;
+
+			continue;
+		}
+
+		type = __IniParser_ClassifyLine(parser, line, lineLength, &info);
+
+		if (afterComment && type == IniLine_Continuation)
+			type = IniLine_Item;
+
+		afterComment = false;
+		position += lineLength;
+
+		if (parser->commentDepth > 0)
+		{
+			size_t skipped = position;
+
+			/* Jump over the whole comment instead of going line by line. */
+			position += __IniParser_SkipBlockComment(parser, buffer + position,
+				length - position);
+
+			if (parser->commentDepth > 0)
+			{
+				__IniFile_SetErrorHintAt(DM_INI_ERROR_MESSAGE_UNTERMINATED_COMMENT,
+					DM_INI_ERROR_CODE_UNTERMINATED_COMMENT,
+					(size_t)(parser->commentStart - buffer));
+
+				/* The rest of the file is comment, there is nothing left. */
+				return __IniDiagnostics_Add(parser->diagnostics, buffer, length);
+			}
+
+			skipped += parser->commentHighBit;
+
+			if (!__IniParser_CheckUtf8(parser, buffer, skipped, position - skipped) &&
+				!__IniDiagnostics_Add(parser->diagnostics, buffer, length))
+			{
+				return false;
+			}
+
+			/* The rest of the closing line still needs to be parsed. */
+			afterComment = true;
+		}
+
+		switch (type)
+		{
+		case IniLine_Section:
+		{
+			const char* close = memchr(line + info.begin + 1,
+				parser->dialect->sectionClose, info.end - info.begin - 1);
+
+			if (!close)
+			{
+				__IniFile_SetErrorHintAt(DM_INI_ERROR_MESSAGE_BAD_SECTION,
+					DM_INI_ERROR_CODE_BAD_SECTION, (size_t)(line + info.begin - buffer));
+
+				/* Items that follow stay in the section before. */
+				if (!__IniDiagnostics_Add(parser->diagnostics, buffer, length))
+					return false;
+
+				break;
+			}
+
+			if (handler->onSection && !handler->onSection(user,
+				__IniFile_TrimSpanWith(parser->dialect, line, info.begin + 1,
+					(size_t)(close - line))))
+			{
+				return false;
+			}
+
+			break;
+		}
+		case IniLine_Item:
+		case IniLine_Continuation:
+		{
+			const char* separator = __IniParser_FindSeparator(parser,
+				line + info.begin, info.end - info.begin);
+			IniSpan first;
+			IniValue value;
+			bool backslash = false;
+			size_t at = 0;
+
+			if (!separator)
+			{
+				__IniFile_SetErrorHintAt(DM_INI_ERROR_MESSAGE_BAD_ITEM,
+					DM_INI_ERROR_CODE_BAD_ITEM, (size_t)(line + info.begin - buffer));
+
+				if (!__IniDiagnostics_Add(parser->diagnostics, buffer, length))
+					return false;
+
+				break;
+			}
+
+			at = (size_t)(separator - line);
+			first = __IniFile_TrimSpanWith(parser->dialect, line, at + 1,
+				info.end);
+
+			value.spans = &first;
+			value.spanCount = 1;
+			value.flags = 0;
+
+			if (first.length && first.data[0] == DM_INI_QUOTE)
+			{
+				if (!__IniParser_TakeQuotes(parser, &first, &value.flags, buffer))
+				{
+					if (!__IniDiagnostics_Add(parser->diagnostics, buffer, length))
+						return false;
+
+					break;
+				}
+			}
+			else
+			{
+				__IniParser_CutComment(parser, &first);
+				backslash = __IniParser_TakeBackslash(parser, &first);
+
+				if (backslash || (parser->indentedContinuation &&
+					position < length &&
+					INI_CLASS_OF(parser->dialect, buffer[position]) == INI_CLASS_SPACE))
+				{
+					value.spanCount = __IniParser_CollectValue(parser, buffer,
+						length, &position, first, backslash);
+					value.spans = parser->spans;
+
+					if (value.spanCount == 0)
+						return false;
+				}
+			}
+
+			if (handler->onItem && !handler->onItem(user,
+				__IniFile_TrimSpanWith(parser->dialect, line, info.begin, at),
+				&value))
+			{
+				return false;
+			}
+
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	return true;
+}
+
+bool IniFile_Parse(const char* buffer, size_t length,
+	const IniOptions* options, const IniHandler* handler, void* user)
+{
+	return __IniFile_ParseWithDiagnostics(buffer, length, options, handler,
+		user, NULL);
+}
+
+bool __IniFile_ParseWithDiagnostics(const char* buffer, size_t length,
+	const IniOptions* options, const IniHandler* handler, void* user,
+	IniDiagnostics* diagnostics)
+{
+	const IniAllocator* allocator = options ? options->allocator : NULL;
+	IniParser parser;
+	char* decoded = NULL;
+	size_t decodedLength = 0;
+	bool result = false;
+
+	__IniFile_ClearErrorHint();
+
+	/* UTF-16 is parsed as UTF-8, as IniFile_ReadBuffer() reads it. */
+	if (!__IniFile_DecodeUtf16(buffer, length, allocator, &decoded,
+		&decodedLength))
+	{
+		return false;
+	}
+
+	if (decoded)
+	{
+		buffer = decoded;
+		length = decodedLength;
+	}
+
+	__IniParser_Initialize(&parser, options);
+	parser.diagnostics = diagnostics;
+
+	if (!buffer)
+		length = 0;
+
+	result = __IniParser_Run(&parser, buffer, length, handler, user);
+
+	if (!result)
+		__IniFile_LocateErrorHint(buffer, length);
+
+	__IniParser_Release(&parser);
+	__IniAllocator_Free(allocator, decoded);
+
+	return result;
+}
+
+bool IniFile_FindSectionText(const char* buffer, size_t length,
+	const char* name, size_t nameLength, const IniOptions* options,
+	IniSpan* text)
+{
+	IniParser parser;
+	IniLineInfo info;
+	IniLineType type;
+	size_t position = 0;
+	bool found = false;
+	bool continued = false;
+	bool inItem = false;
+
+	__IniFile_ClearErrorHint();
+
+	if (!buffer || !text)
+		return false;
+
+	/* text has to point into buffer, so UTF-16 can not be converted here. */
+	if (__IniFile_HasUtf16Mark(buffer, length))
+	{
+		__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_UTF16_TEXT,
+			DM_INI_ERROR_CODE_BAD_UTF16);
+
+		return false;
+	}
+
+	__IniParser_Initialize(&parser, options);
+	position = __IniParser_Start(&parser, buffer, length);
+
+	/* The global items start at the top, anything else after its header. */
+	if (!name)
+	{
+		found = true;
+		text->data = buffer + position;
+	}
+
+	while (position < length)
+	{
+		const char* line = buffer + position;
+		const char* newline = memchr(line, '\n', length - position);
+		size_t lineLength = newline ? (size_t)(newline - line) + 1 :
+			length - position;
+
+		type = __IniFile_ClassifyLineWith(parser.dialect, line, lineLength,
+			&info);
+
+		/* Lines that belong to the value above are never declarations. */
+		if (continued || (inItem && parser.indentedContinuation &&
+			type == IniLine_Continuation))
+		{
+			continued = parser.lineContinuation && info.end > info.begin &&
+				line[info.end - 1] == DM_INI_LINE_CONTINUATION;
+			position += lineLength;
+
+			continue;
+		}
+
+		inItem = false;
+
+		if (type == IniLine_BlockComment)
+		{
+			parser.commentDepth = 1;
+			position += info.begin + 2;
+			position += __IniParser_SkipBlockComment(&parser, buffer + position,
+				length - position);
+
+			if (parser.commentDepth > 0)
+			{
+				__IniFile_SetErrorHintAt(DM_INI_ERROR_MESSAGE_UNTERMINATED_COMMENT,
+					DM_INI_ERROR_CODE_UNTERMINATED_COMMENT,
+					(size_t)(line + info.begin - buffer));
+				__IniFile_LocateErrorHint(buffer, length);
+				__IniParser_Release(&parser);
+
+				return false;
+			}
+
+			/* The rest of the closing line is read as a line of its own. */
+			continue;
+		}
+
+		if (type == IniLine_Section)
+		{
+			const char* close = memchr(line + info.begin + 1,
+				parser.dialect->sectionClose, info.end - info.begin - 1);
+			IniSpan declared;
+
+			if (found)
+				break;
+
+			position += lineLength;
+
+			if (!close)
+				continue;
+
+			declared = __IniFile_TrimSpanWith(parser.dialect, line,
+				info.begin + 1, (size_t)(close - line));
+
+			if (name && declared.length == nameLength &&
+				memcmp(declared.data, name, nameLength) == 0)
+			{
+				found = true;
+				text->data = buffer + position;
+			}
+
+			continue;
+		}
+
+		if (type == IniLine_Item || type == IniLine_Continuation)
+		{
+			/* Quoted values end in a quote, so this only catches the
+			 * unquoted ones the parser would continue. */
+			inItem = true;
+			continued = parser.lineContinuation &&
+				line[info.end - 1] == DM_INI_LINE_CONTINUATION;
+		}
+
+		position += lineLength;
+	}
+
+	__IniParser_Release(&parser);
+
+	if (found)
+		text->length = (size_t)(buffer + position - text->data);
+
+	return found;
+}
+
+/* Arrays */
+
+static IniSpan __IniFile_NoElements[1];
+
+/* Splits the value of item into its cached elements. */
+static bool __IniFile_SplitItem(IniFile* file, IniItem* item)
+{
+	const char* text = __IniFile_ResolveValue(file, item);
+	size_t length = item->valueLength;
+	size_t count = 0;
+	size_t start = 0;
+	size_t i = 0;
+	IniSpan* elements = NULL;
+
+	if (!text)
+		return false;
+
+	if (length == 0)
+	{
+		item->elements = __IniFile_NoElements;
+		item->elementCount = 0;
+
+		return true;
+	}
+
+	if (item->flags & DM_INI_VALUE_QUOTED)
+		count = 1;
+	else
+		count = __IniFile_CountByte(text, length, DM_INI_LIST_SEPARATOR) + 1;
+
+	elements = __IniArena_Allocate(&file->arena, count * sizeof(IniSpan));
+
+	if (!elements)
+		return false;
+
+	count = 0;
+
+	if (!(item->flags & DM_INI_VALUE_QUOTED))
+	{
+#if DM_INI_USE_SSE2
+		const __m128i separator = _mm_set1_epi8(DM_INI_LIST_SEPARATOR);
+
+		for (; i + 16 <= length; i += 16)
+		{
+			__m128i chunk = _mm_loadu_si128((const __m128i*)(text + i));
+			unsigned int mask = (unsigned int)_mm_movemask_epi8(
+				_mm_cmpeq_epi8(chunk, separator));
+
+			while (mask)
+			{
+				size_t at = i + __IniFile_CountTrailingZeros(mask);
+
+				elements[count++] = __IniFile_TrimSpan(text, start, at);
+				start = at + 1;
+				mask &= mask - 1;
+			}
+		}
+#endif
+
+		for (; i < length; ++i)
+		{
+			if (text[i] == DM_INI_LIST_SEPARATOR)
+			{
+				elements[count++] = __IniFile_TrimSpan(text, start, i);
+				start = i + 1;
+			}
+		}
+
+		elements[count++] = __IniFile_TrimSpan(text, start, length);
+	}
+	else
+	{
+		elements[count].data = text;
+		elements[count++].length = length;
+	}
+
+	item->elements = elements;
+	item->elementCount = count;
+	item->elementCapacity = count;
+
+	return true;
+}
+
+bool IniFile_GetArray(IniFile* file, const char* section, const char* key,
+	const IniSpan** elements, size_t* count)
+{
+	IniItem* item = IniFile_GetItem(file, section, key);
+
+	if (!item)
+		return false;
+
+	if (!item->elements && !__IniFile_SplitItem(file, item))
+		return false;
+
+	if (elements)
+		*elements = item->elements;
+
+	if (count)
+		*count = item->elementCount;
+
+	return true;
+}
+
+/* Hierarchical queries */
+
+bool IniFile_ForEachUnder(IniFile* file, const char* prefix,
+	IniSectionCallback callback, void* user)
+{
+	const IniSectionTree* tree = NULL;
+	size_t length = 0;
+	size_t consumed = 0;
+	bool childrenOnly = false;
+	uint32_t root = 0;
+	uint32_t node = 0;
+
+	if (!file || !callback)
+		return true;
+
+	if (!__IniFile_BuildTree(file))
+		return false;
+
+	tree = &file->tree;
+
+	if (!prefix)
+		prefix = "";
+
+	length = strlen(prefix);
+
+	if (length && prefix[length - 1] == DM_INI_PATH_SEPARATOR)
+	{
+		childrenOnly = true;
+		--length;
+	}
+
+	root = __IniTree_Walk(tree, prefix, length, &consumed);
+
+	if (consumed != length)
+		return true;
+
+	if (!childrenOnly && root != 0 && tree->nodes[root].section != INI_TREE_NONE)
+	{
+		if (!callback(user, &file->sectionList[tree->nodes[root].section]))
+			return true;
+	}
+
+	/* Depth first through the subtree without a stack. */
+	node = tree->nodes[root].firstChild;
+
+	while (node != INI_TREE_NONE)
+	{
+		const IniTreeNode* current = &tree->nodes[node];
+
+		if (current->section != INI_TREE_NONE &&
+			!callback(user, &file->sectionList[current->section]))
+		{
+			return true;
+		}
+
+		if (current->firstChild != INI_TREE_NONE)
+		{
+			node = current->firstChild;
+
+			continue;
+		}
+
+		while (node != root && tree->nodes[node].nextSibling == INI_TREE_NONE)
+			node = tree->nodes[node].parent;
+
+		node = node == root ? INI_TREE_NONE : tree->nodes[node].nextSibling;
+	}
+
+	return true;
+}
+
+IniItem* IniFile_GetPath(IniFile* file, const char* path)
+{
+	const IniSectionTree* tree = NULL;
+	size_t length = 0;
+	size_t consumed = 0;
+	uint32_t node = 0;
+
+	if (!file || !path)
+		return NULL;
+
+	if (!__IniFile_BuildTree(file))
+		return NULL;
+
+	tree = &file->tree;
+
+	length = strlen(path);
+	node = __IniTree_Walk(tree, path, length, &consumed);
+
+	/* Try the deepest section first, then back up towards the root. */
+	for (; node != 0; node = tree->nodes[node].parent)
+	{
+		const IniTreeNode* current = &tree->nodes[node];
+		const char* key = path + current->pathLength + 1;
+		size_t keyLength = 0;
+		IniItem* item = NULL;
+
+		if (current->section == INI_TREE_NONE ||
+			current->pathLength + 1 >= length)
+		{
+			continue;
+		}
+
+		keyLength = length - current->pathLength - 1;
+
+		item = __IniSection_Find(&file->sectionList[current->section], key,
+			keyLength, __IniFile_HashSpan(key, keyLength));
+
+		if (item)
+			return item;
+	}
+
+	/* A path without a matching section may still be a global item. */
+	return __IniSection_Find(&file->globalSection, path, length,
+		__IniFile_HashSpan(path, length));
+}
+
+/* Ordered views */
+
+typedef int (*IniOrderCompare)(const void* context, uint32_t a, uint32_t b);
+
+static int __IniFile_CompareKeys(const char* a, size_t aLength, const char* b,
+	size_t bLength)
+{
+	int result = memcmp(a, b, aLength < bLength ? aLength : bLength);
+
+	if (result)
+		return result;
+
+	return aLength < bLength ? -1 : (aLength > bLength ? 1 : 0);
+}
+
+static int __IniSection_CompareItems(const void* context, uint32_t a,
+	uint32_t b)
+{
+	const IniSection* section = (const IniSection*)context;
+	const IniItem* left = &section->itemList[a];
+	const IniItem* right = &section->itemList[b];
+
+	return __IniFile_CompareKeys(left->key, left->keyLength, right->key,
+		right->keyLength);
+}
+
+static int __IniFile_CompareSections(const void* context, uint32_t a,
+	uint32_t b)
+{
+	const IniFile* file = (const IniFile*)context;
+
+	return strcmp(file->sectionList[a].name, file->sectionList[b].name);
+}
+
+/* Fills positions with 0..count-1 in order, using a stable merge sort. */
+static uint32_t* __IniFile_Order(const IniAllocator* allocator,
+	uint32_t* positions, size_t count, IniOrderCompare compare,
+	const void* context)
+{
+	uint32_t* from = NULL;
+	uint32_t* to = NULL;
+	uint32_t* scratch = NULL;
+	size_t width;
+	size_t i;
+
+	from = __IniAllocator_Reallocate(allocator, positions,
+		(count ? count : 1) * sizeof(uint32_t));
+
+	if (!from)
+	{
+		__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_MALLOC_FAIL, 9);
+
+		__IniAllocator_Free(allocator, positions);
+
+		return NULL;
+	}
+
+	positions = from;
+
+	for (i = 0; i < count; ++i)
+		positions[i] = (uint32_t)i;
+
+	if (count < 2)
+		return positions;
+
+	scratch = __IniAllocator_Allocate(allocator, count * sizeof(uint32_t));
+
+	if (!scratch)
+	{
+		__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_MALLOC_FAIL, 9);
+
+		__IniAllocator_Free(allocator, positions);
+
+		return NULL;
+	}
+
+	to = scratch;
+
+	for (width = 1; width < count; width *= 2)
+	{
+		uint32_t* swap = NULL;
+
+		for (i = 0; i < count; i += 2 * width)
+		{
+			size_t middle = i + width < count ? i + width : count;
+			size_t end = i + 2 * width < count ? i + 2 * width : count;
+			size_t left = i;
+			size_t right = middle;
+			size_t k = i;
+
+			/* Only take from the right on strictly less to stay stable. */
+			while (left < middle && right < end)
+			{
+				if (compare(context, from[right], from[left]) < 0)
+					to[k++] = from[right++];
+				else
+					to[k++] = from[left++];
+			}
+
+			while (left < middle)
+				to[k++] = from[left++];
+
+			while (right < end)
+				to[k++] = from[right++];
+		}
+
+		swap = from;
+		from = to;
+		to = swap;
+	}
+
+	if (from != positions)
+		memcpy(positions, from, count * sizeof(uint32_t));
+
+	__IniAllocator_Free(allocator, scratch);
+
+	return positions;
+}
+
+static bool __IniSection_Sort(IniSection* section)
+{
+	if (section->sorted)
+		return true;
+
+	section->sortedItems = __IniFile_Order(section->allocator,
+		section->sortedItems, section->itemCount, __IniSection_CompareItems,
+		section);
+
+	section->sorted = section->sortedItems != NULL;
+
+	return section->sorted;
+}
+
+static bool __IniFile_SortSections(IniFile* file)
+{
+	if (file->sorted)
+		return true;
+
+	file->sortedSections = __IniFile_Order(&file->allocator,
+		file->sortedSections, file->sectionCount, __IniFile_CompareSections,
+		file);
+
+	file->sorted = file->sortedSections != NULL;
+
+	return file->sorted;
+}
+
+bool IniSection_ForEachSorted(IniSection* section, IniItemCallback callback,
+	void* user)
+{
+	return IniSection_Range(section, NULL, NULL, callback, user);
+}
+
+bool IniSection_Range(IniSection* section, const char* lo, const char* hi,
+	IniItemCallback callback, void* user)
+{
+	size_t first = 0;
+	size_t last = 0;
+	size_t hiLength = hi ? strlen(hi) : 0;
+	size_t i;
+
+	if (!section || !callback)
+		return true;
+
+	if (!__IniSection_Sort(section))
+		return false;
+
+	last = section->itemCount;
+
+	if (lo)
+	{
+		size_t loLength = strlen(lo);
+		size_t count = section->itemCount;
+
+		/* Lower bound of lo. */
+		while (count > 0)
+		{
+			size_t step = count / 2;
+			const IniItem* item =
+				&section->itemList[section->sortedItems[first + step]];
+
+			if (__IniFile_CompareKeys(item->key, item->keyLength, lo,
+				loLength) < 0)
+			{
+				first += step + 1;
+				count -= step + 1;
+			}
+			else
+			{
+				count = step;
+			}
+		}
+	}
+
+	for (i = first; i < last; ++i)
+	{
+		IniItem* item = &section->itemList[section->sortedItems[i]];
+
+		if (hi && __IniFile_CompareKeys(item->key, item->keyLength, hi,
+			hiLength) >= 0)
+		{
+			break;
+		}
+
+		if (!callback(user, item))
+			break;
+	}
+
+	return true;
+}
+
+/* Writing */
+
+static bool __IniFile_NeedsQuotes(const char* value, size_t length)
+{
+	size_t i;
+
+	if (length == 0)
+		return false;
+
+	if (INI_CHAR_CLASS(value[0]) == INI_CLASS_SPACE ||
+		INI_CHAR_CLASS(value[length - 1]) == INI_CLASS_SPACE ||
+		value[0] == DM_INI_QUOTE ||
+		value[length - 1] == DM_INI_LINE_CONTINUATION)
+	{
+		return true;
+	}
+
+	for (i = 0; i < length; ++i)
+	{
+		if ((unsigned char)value[i] < 0x20 || value[i] == 0x7F)
+			return true;
+	}
+
+	return false;
+}
+
+static void __IniFile_WriteValue(FILE* fp, const char* value, size_t length)
+{
+	size_t i;
+
+	if (!__IniFile_NeedsQuotes(value, length))
+	{
+		fwrite(value, 1, length, fp);
+
+		return;
+	}
+
+	fputc(DM_INI_QUOTE, fp);
+
+	for (i = 0; i < length; ++i)
+	{
+		unsigned char c = (unsigned char)value[i];
+
+		switch (c)
+		{
+		case '\n': fputs("\\n", fp); break;
+		case '\t': fputs("\\t", fp); break;
+		case '\r': fputs("\\r", fp); break;
+		case '"': fputs("\\\"", fp); break;
+		case '\\': fputs("\\\\", fp); break;
+		default:
+			if (c < 0x20 || c == 0x7F)
+				fprintf(fp, "\\u%04x", c);
+			else
+				fputc(c, fp);
+			break;
+		}
+	}
+
+	fputc(DM_INI_QUOTE, fp);
+}
+
+static bool __IniFile_WriteItem(IniFile* file, FILE* fp, IniItem* item)
+{
+	size_t i;
+
+	if (item->flags & DM_INI_VALUE_ARRAY)
+	{
+		for (i = 0; i < item->elementCount; ++i)
+		{
+			fwrite(item->key, 1, item->keyLength, fp);
+			fprintf(fp, "%c%c=", DM_LEFT_BRACKET, DM_RIGHT_BRACKET);
+			__IniFile_WriteValue(fp, item->elements[i].data,
+				item->elements[i].length);
+			fputc('\n', fp);
+		}
+
+		return true;
+	}
+
+	if (!__IniFile_ResolveValue(file, item))
+		return false;
+
+	fwrite(item->key, 1, item->keyLength, fp);
+	fputc('=', fp);
+	__IniFile_WriteValue(fp, item->value, item->valueLength);
+	fputc('\n', fp);
+
+	return true;
+}
+
+static bool __IniFile_WriteItems(IniFile* file, FILE* fp, IniSection* section,
+	unsigned int flags)
+{
+	size_t i;
+
+	if ((flags & DM_INI_WRITE_SORTED) && !__IniSection_Sort(section))
+		return false;
+
+	for (i = 0; i < section->itemCount; ++i)
+	{
+		size_t position = (flags & DM_INI_WRITE_SORTED) ?
+			section->sortedItems[i] : i;
+
+		if (!__IniFile_WriteItem(file, fp, &section->itemList[position]))
+			return false;
+	}
+
+	return true;
+}
+
+bool IniFile_Write(IniFile* file, FILE* fp, unsigned int flags)
+{
+	size_t i;
+
+	__IniFile_ClearErrorHint();
+
+	if (!file || !fp)
+		return false;
+
+	if ((flags & DM_INI_WRITE_SORTED) && !__IniFile_SortSections(file))
+		return false;
+
+	if (!__IniFile_WriteItems(file, fp, &file->globalSection, flags))
+		return false;
+
+	for (i = 0; i < file->sectionCount; ++i)
+	{
+		size_t position = (flags & DM_INI_WRITE_SORTED) ?
+			file->sortedSections[i] : i;
+		IniSection* section = &file->sectionList[position];
+
+		if (i > 0 || file->globalSection.itemCount > 0)
+			fputc('\n', fp);
+
+		fprintf(fp, "%c%s%c\n", DM_LEFT_BRACKET, section->name,
+			DM_RIGHT_BRACKET);
+
+		if (!__IniFile_WriteItems(file, fp, section, flags))
+			return false;
+	}
+
+	if (ferror(fp))
+	{
+		__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_FWRITE_FAIL, errno);
+
+		return false;
+	}
+
+	return true;
+}
+
+bool IniFile_WriteFile(IniFile* file, const char* filename,
+	unsigned int flags)
+{
+	FILE* fp = NULL;
+	bool result = false;
+
+	__IniFile_ClearErrorHint();
+
+	fp = fopen(filename, "wb");
+
+	if (!fp)
+	{
+		__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_FOPEN_FAIL, errno);
+
+		return false;
+	}
+
+	result = IniFile_Write(file, fp, flags);
+
+	if (fclose(fp) != 0 && result)
+	{
+		__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_FWRITE_FAIL, errno);
+
+		result = false;
+	}
+
+	return result;
+}
+
+/* JSON */
+
+// Bytes gathered before they are handed to fwrite().
+#define INI_JSON_BUFFER 16384
+
+typedef struct
+{
+	FILE* fp;
+	unsigned int flags;
+	bool failed;
+
+	/* Section of the items being written, data NULL for the global items. */
+	IniSpan section;
+
+	/* Whether anything has been written to the outer or the section object. */
+	bool outerUsed;
+	bool sectionUsed;
+
+	/* Name of the array being written, data NULL when there is none. */
+	IniSpan array;
+
+	/* Values that have to be joined or decoded before they are escaped. */
+	char* scratch;
+	size_t scratchCapacity;
+	const IniAllocator* allocator;
+
+	size_t used;
+	char data[INI_JSON_BUFFER];
+} IniJsonWriter;
+
+static void __IniJson_Flush(IniJsonWriter* writer)
+{
+	if (writer->used && !writer->failed &&
+		fwrite(writer->data, 1, writer->used, writer->fp) != writer->used)
+	{
+		writer->failed = true;
+	}
+
+	writer->used = 0;
+}
+
+static void __IniJson_Write(IniJsonWriter* writer, const char* text,
+	size_t length)
+{
+	if (writer->used + length > INI_JSON_BUFFER)
+	{
+		__IniJson_Flush(writer);
+
+		/* Too big to be worth buffering. */
+		if (length > INI_JSON_BUFFER)
+		{
+			if (!writer->failed && fwrite(text, 1, length, writer->fp) != length)
+				writer->failed = true;
+
+			return;
+		}
+	}
+
+	memcpy(writer->data + writer->used, text, length);
+	writer->used += length;
+}
+
+static void __IniJson_WriteByte(IniJsonWriter* writer, char c)
+{
+	if (writer->used == INI_JSON_BUFFER)
+		__IniJson_Flush(writer);
+
+	writer->data[writer->used++] = c;
+}
+
+/* Counts the bytes at the start of text that JSON takes as they are. */
+static size_t __IniJson_PlainLength(const char* text, size_t length)
+{
+	size_t i = 0;
+
+#if DM_INI_USE_SSE2
+	{
+		const __m128i quote = _mm_set1_epi8('"');
+		const __m128i backslash = _mm_set1_epi8('\\');
+		const __m128i control = _mm_set1_epi8(0x1F);
+
+		while (i + 16 <= length)
+		{
+			__m128i chunk = _mm_loadu_si128((const __m128i*)(text + i));
+
+			/* A byte is a control character if it is its own minimum with
+			 * 0x1F, compared unsigned. */
+			__m128i special = _mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+					_mm_cmpeq_epi8(chunk, backslash)),
+				_mm_cmpeq_epi8(_mm_min_epu8(chunk, control), chunk));
+			unsigned int mask = (unsigned int)_mm_movemask_epi8(special);
+
+			if (mask)
+				return i + __IniFile_CountTrailingZeros(mask);
+
+			i += 16;
+		}
+	}
+#endif
+
+	while (i < length && text[i] != '"' && text[i] != '\\' &&
+		(unsigned char)text[i] >= 0x20)
+	{
+		++i;
+	}
+
+	return i;
+}
+
+static void __IniJson_WriteString(IniJsonWriter* writer, const char* text,
+	size_t length)
+{
+	static const char hex[] = "0123456789abcdef";
+	size_t i = 0;
+
+	__IniJson_WriteByte(writer, '"');
+
+	while (i < length)
+	{
+		size_t plain = __IniJson_PlainLength(text + i, length - i);
+		char escape[6] = { '\\', 'u', '0', '0', 0, 0 };
+		unsigned char c = 0;
+
+		__IniJson_Write(writer, text + i, plain);
+		i += plain;
+
+		if (i == length)
+			break;
+
+		c = (unsigned char)text[i++];
+
+		switch (c)
+		{
+		case '"': escape[1] = '"'; break;
+		case '\\': escape[1] = '\\'; break;
+		case '\b': escape[1] = 'b'; break;
+		case '\f': escape[1] = 'f'; break;
+		case '\n': escape[1] = 'n'; break;
+		case '\r': escape[1] = 'r'; break;
+		case '\t': escape[1] = 't'; break;
+		default:
+			escape[4] = hex[c >> 4];
+			escape[5] = hex[c & 0xF];
+			__IniJson_Write(writer, escape, 6);
+			continue;
+		}
+
+		__IniJson_Write(writer, escape, 2);
+	}
+
+	__IniJson_WriteByte(writer, '"');
+}
+
+static void __IniJson_WriteValue(IniJsonWriter* writer, const IniValue* value)
+{
+	size_t length = 0;
+
+	/* Most values are a single plain span and are escaped where they lie. */
+	if (value->spanCount == 1 && !(value->flags & DM_INI_VALUE_ESCAPED))
+	{
+		__IniJson_WriteString(writer, value->spans[0].data,
+			value->spans[0].length);
+
+		return;
+	}
+
+	length = IniValue_Join(value, NULL);
+
+	if (length > writer->scratchCapacity)
+	{
+		char* scratch = __IniAllocator_Reallocate(writer->allocator,
+			writer->scratch, length);
+
+		if (!scratch)
+		{
+			__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_MALLOC_FAIL, 12);
+			writer->failed = true;
+
+			return;
+		}
+
+		writer->scratch = scratch;
+		writer->scratchCapacity = length;
+	}
+
+	IniValue_Join(value, writer->scratch);
+	__IniJson_WriteString(writer, writer->scratch, length);
+}
+
+static void __IniJson_CloseArray(IniJsonWriter* writer)
+{
+	if (!writer->array.data)
+		return;
+
+	__IniJson_WriteByte(writer, ']');
+	writer->array.data = NULL;
+}
+
+static bool __IniJson_OnSection(void* user, IniSpan name)
+{
+	IniJsonWriter* writer = (IniJsonWriter*)user;
+
+	if (writer->flags & DM_INI_JSON_LINES)
+	{
+		writer->section = name;
+
+		return !writer->failed;
+	}
+
+	__IniJson_CloseArray(writer);
+
+	if (writer->section.data)
+		__IniJson_WriteByte(writer, '}');
+
+	writer->section = name;
+
+	if (writer->outerUsed)
+		__IniJson_WriteByte(writer, ',');
+
+	__IniJson_WriteString(writer, name.data, name.length);
+	__IniJson_Write(writer, ":{", 2);
+
+	writer->outerUsed = true;
+	writer->sectionUsed = false;
+
+	return !writer->failed;
+}
+
+static bool __IniJson_OnItem(void* user, IniSpan key, const IniValue* value)
+{
+	IniJsonWriter* writer = (IniJsonWriter*)user;
+	bool array = key.length >= 2 &&
+		key.data[key.length - 2] == DM_LEFT_BRACKET &&
+		key.data[key.length - 1] == DM_RIGHT_BRACKET;
+	bool* used = writer->section.data ? &writer->sectionUsed :
+		&writer->outerUsed;
+
+	if (array)
+		key.length -= 2;
+
+	if (writer->flags & DM_INI_JSON_LINES)
+	{
+		__IniJson_Write(writer, "{\"section\":", 11);
+
+		if (writer->section.data)
+			__IniJson_WriteString(writer, writer->section.data,
+				writer->section.length);
+		else
+			__IniJson_Write(writer, "null", 4);
+
+		__IniJson_Write(writer, ",\"key\":", 7);
+		__IniJson_WriteString(writer, key.data, key.length);
+		__IniJson_Write(writer, ",\"value\":", 9);
+		__IniJson_WriteValue(writer, value);
+		__IniJson_Write(writer, "}\n", 2);
+
+		return !writer->failed;
+	}
+
+	/* Another element of the array already being written. */
+	if (array && writer->array.data && writer->array.length == key.length &&
+		memcmp(writer->array.data, key.data, key.length) == 0)
+	{
+		__IniJson_WriteByte(writer, ',');
+		__IniJson_WriteValue(writer, value);
+
+		return !writer->failed;
+	}
+
+	__IniJson_CloseArray(writer);
+
+	if (*used)
+		__IniJson_WriteByte(writer, ',');
+
+	__IniJson_WriteString(writer, key.data, key.length);
+	__IniJson_WriteByte(writer, ':');
+
+	if (array)
+	{
+		__IniJson_WriteByte(writer, '[');
+		writer->array = key;
+	}
+
+	__IniJson_WriteValue(writer, value);
+	*used = true;
+
+	return !writer->failed;
+}
+
+bool IniFile_ParseToJson(const char* buffer, size_t length,
+	const IniOptions* options, unsigned int flags, FILE* fp)
+{
+	IniHandler handler = { __IniJson_OnSection, __IniJson_OnItem };
+	const IniAllocator* allocator = options ? options->allocator : NULL;
+	IniJsonWriter* writer = NULL;
+	bool result = false;
+
+	__IniFile_ClearErrorHint();
+
+	if (!fp)
+		return false;
+
+	writer = __IniAllocator_Allocate(allocator, sizeof(IniJsonWriter));
+
+	if (!writer)
+	{
+		__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_MALLOC_FAIL, 12);
+
+		return false;
+	}
+
+	memset(writer, 0, offsetof(IniJsonWriter, data));
+	writer->fp = fp;
+	writer->flags = flags;
+	writer->allocator = allocator;
+
+	if (!(flags & DM_INI_JSON_LINES))
+		__IniJson_WriteByte(writer, '{');
+
+	result = IniFile_Parse(buffer, length, options, &handler, writer);
+
+	if (result && !(flags & DM_INI_JSON_LINES))
+	{
+		__IniJson_CloseArray(writer);
+
+		if (writer->section.data)
+			__IniJson_WriteByte(writer, '}');
+
+		__IniJson_Write(writer, "}\n", 2);
+	}
+
+	__IniJson_Flush(writer);
+
+	if (writer->failed && !IniFile_GetErrorHint())
+		__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_FWRITE_FAIL, errno);
+
+	result = result && !writer->failed;
+
+	__IniAllocator_Free(allocator, writer->scratch);
+	__IniAllocator_Free(allocator, writer);
+
+	return result;
+}
+
+/* Embedded images */
+
+// Seeds tried per bucket before giving up on a perfect hash.
+#define INI_IMAGE_MAX_SEED (1u << 20)
+
+static uint32_t __IniImage_Mix(uint32_t hash)
+{
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6bu;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35u;
+	hash ^= hash >> 16;
+
+	return hash;
+}
+
+static uint32_t __IniImage_Hash(const char* section, size_t sectionLength,
+	const char* key, size_t keyLength)
+{
+	return __IniImage_Mix(__IniFile_HashSpan(section, sectionLength)) ^
+		__IniFile_HashSpan(key, keyLength);
+}
+
+static size_t __IniImage_Bucket(uint32_t hash, size_t seedCount)
+{
+	return __IniImage_Mix(hash) % seedCount;
+}
+
+static size_t __IniImage_Slot(uint32_t hash, uint32_t seed, size_t slotCount)
+{
+	return __IniImage_Mix(hash + (seed + 1) * 2654435761u) % slotCount;
+}
+
+/* Finds a seed for every bucket, largest buckets first while slots are free. */
+static bool __IniImage_Seed(uint32_t* seeds, size_t seedCount,
+	uint32_t* slots, size_t slotCount, const uint32_t* positions, size_t count,
+	const uint32_t* hashes)
+{
+	size_t* starts = NULL;
+	uint32_t* members = NULL;
+	size_t largest = 0;
+	size_t size = 0;
+	size_t i;
+	bool result = true;
+
+	starts = calloc(seedCount + 1, sizeof(size_t));
+	members = malloc((count ? count : 1) * sizeof(uint32_t));
+
+	if (!starts || !members)
+	{
+		__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_MALLOC_FAIL, 9);
+
+		free(starts);
+		free(members);
+
+		return false;
+	}
+
+	/* Group the positions by bucket, starts[b] ends up where bucket b begins. */
+	for (i = 0; i < count; ++i)
+		starts[__IniImage_Bucket(hashes[positions[i]], seedCount) + 1]++;
+
+	for (i = 0; i < seedCount; ++i)
+	{
+		if (starts[i + 1] > largest)
+			largest = starts[i + 1];
+
+		starts[i + 1] += starts[i];
+	}
+
+	for (i = 0; i < count; ++i)
+	{
+		size_t bucket = __IniImage_Bucket(hashes[positions[i]], seedCount);
+
+		members[starts[bucket]++] = positions[i];
+	}
+
+	for (i = seedCount; i > 0; --i)
+		starts[i] = starts[i - 1];
+
+	starts[0] = 0;
+
+	for (i = 0; i < slotCount; ++i)
+		slots[i] = DM_INI_IMAGE_EMPTY;
+
+	for (size = largest; size > 0 && result; --size)
+	{
+		size_t bucket;
+
+		for (bucket = 0; bucket < seedCount && result; ++bucket)
+		{
+			const uint32_t* group = members + starts[bucket];
+			uint32_t seed = 0;
+
+			if (starts[bucket + 1] - starts[bucket] != size)
+				continue;
+
+			for (seed = 0; seed < INI_IMAGE_MAX_SEED; ++seed)
+			{
+				size_t j;
+
+				for (j = 0; j < size; ++j)
+				{
+					size_t slot = __IniImage_Slot(hashes[group[j]], seed,
+						slotCount);
+
+					if (slots[slot] != DM_INI_IMAGE_EMPTY)
+						break;
+
+					slots[slot] = group[j];
+				}
+
+				if (j == size)
+					break;
+
+				/* Undo this attempt before trying the next seed. */
+				while (j-- > 0)
+					slots[__IniImage_Slot(hashes[group[j]], seed, slotCount)] =
+						DM_INI_IMAGE_EMPTY;
+			}
+
+			if (seed == INI_IMAGE_MAX_SEED)
+			{
+				__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_IMAGE_COLLISION,
+					DM_INI_ERROR_CODE_IMAGE_COLLISION);
+
+				result = false;
+			}
+
+			seeds[bucket] = seed;
+		}
+	}
+
+	free(starts);
+	free(members);
+
+	return result;
+}
+
+IniImage* IniImage_Build(IniFile* file)
+{
+	IniImage* image = NULL;
+	IniImageSection* sections = NULL;
+	IniImageItem* items = NULL;
+	uint32_t* hashes = NULL;
+	uint32_t* positions = NULL;
+	size_t itemCount = 0;
+	size_t hashedCount = 0;
+	size_t position = 0;
+	size_t s;
+	bool failed = false;
+
+	if (!file) return NULL;
+
+	__IniFile_ClearErrorHint();
+
+	itemCount = file->globalSection.itemCount;
+
+	for (s = 0; s < file->sectionCount; ++s)
+		itemCount += file->sectionList[s].itemCount;
+
+	image = calloc(1, sizeof(IniImage));
+	sections = malloc((file->sectionCount + 1) * sizeof(IniImageSection));
+	items = malloc((itemCount ? itemCount : 1) * sizeof(IniImageItem));
+	hashes = malloc((itemCount ? itemCount : 1) * sizeof(uint32_t));
+	positions = malloc((itemCount ? itemCount : 1) * sizeof(uint32_t));
+
+	if (image)
+	{
+		image->seedCount = itemCount / 4 + 1;
+		image->slotCount = itemCount + itemCount / 4 + 1;
+		image->seeds = calloc(image->seedCount, sizeof(uint32_t));
+		image->slots = malloc(image->slotCount * sizeof(uint32_t));
+	}
+
+	if (!image || !sections || !items || !hashes || !positions ||
+		!image->seeds || !image->slots)
+	{
+		__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_MALLOC_FAIL, 9);
+
+		failed = true;
+	}
+
+	for (s = 0; s <= file->sectionCount && !failed; ++s)
+	{
+		IniSection* section = s ? &file->sectionList[s - 1] :
+			&file->globalSection;
+		IniImageSection* imageSection = &sections[s];
+		size_t i;
+
+		imageSection->name = s ? section->name : "";
+		imageSection->nameLength = strlen(imageSection->name);
+		imageSection->firstItem = position;
+		imageSection->itemCount = section->itemCount;
+
+		for (i = 0; i < section->itemCount; ++i, ++position)
+		{
+			IniItem* item = &section->itemList[i];
+			IniImageItem* imageItem = &items[position];
+
+			imageItem->value = __IniFile_ResolveValue(file, item);
+
+			if (!imageItem->value)
+			{
+				failed = true;
+
+				break;
+			}
+
+			imageItem->key = item->key;
+			imageItem->keyLength = item->keyLength;
+			imageItem->valueLength = item->valueLength;
+			imageItem->section = s;
+			imageItem->elements = NULL;
+			imageItem->elementCount = 0;
+
+			if (item->flags & DM_INI_VALUE_ARRAY)
+			{
+				imageItem->elements = item->elements;
+				imageItem->elementCount = item->elementCount;
+			}
+
+			hashes[position] = __IniImage_Hash(imageSection->name,
+				imageSection->nameLength, item->key, item->keyLength);
+
+			/* Only the copy of a repeated key that lookups find is hashed. */
+			if (__IniSection_Find(section, item->key, item->keyLength,
+				item->hash) == item)
+			{
+				positions[hashedCount++] = (uint32_t)position;
+			}
+		}
+	}
+
+	if (!failed)
+	{
+		failed = !__IniImage_Seed((uint32_t*)image->seeds, image->seedCount,
+			(uint32_t*)image->slots, image->slotCount, positions, hashedCount,
+			hashes);
+	}
+
+	free(hashes);
+	free(positions);
+
+	if (image)
+	{
+		image->sections = sections;
+		image->sectionCount = file->sectionCount + 1;
+		image->items = items;
+		image->itemCount = itemCount;
+	}
+	else
+	{
+		free(sections);
+		free(items);
+	}
+
+	if (failed)
+	{
+		IniImage_Free(image);
+
+		return NULL;
+	}
+
+	return image;
+}
+
+void IniImage_Free(IniImage* image)
+{
+	if (!image) return;
+
+	free((IniImageSection*)image->sections);
+	free((IniImageItem*)image->items);
+	free((uint32_t*)image->seeds);
+	free((uint32_t*)image->slots);
+
+	free(image);
+}
+
+static void __IniImage_WriteString(FILE* fp, const char* text, size_t length)
+{
+	size_t i;
+
+	fputc('"', fp);
+
+	for (i = 0; i < length; ++i)
+	{
+		unsigned char c = (unsigned char)text[i];
+
+		/* '?' is escaped so that no trigraphs sneak in. */
+		if (c == '"' || c == '\\' || c == '?')
+			fprintf(fp, "\\%c", c);
+		else if (c < 0x20 || c >= 0x7f)
+			fprintf(fp, "\\%03o", c);
+		else
+			fputc(c, fp);
+	}
+
+	fputc('"', fp);
+}
+
+static void __IniImage_WriteTable(FILE* fp, const char* name,
+	const char* table, const uint32_t* values, size_t count)
+{
+	size_t i;
+
+	fprintf(fp, "static const uint32_t %s_%s[] =\n{", name, table);
+
+	for (i = 0; i < count; ++i)
+	{
+		if (i % 8 == 0)
+			fputs("\n\t", fp);
+		else
+			fputc(' ', fp);
+
+		if (values[i] == DM_INI_IMAGE_EMPTY)
+			fputs("DM_INI_IMAGE_EMPTY,", fp);
+		else
+			fprintf(fp, "%lu,", (unsigned long)values[i]);
+	}
+
+	fputs("\n};\n\n", fp);
+}
+
+bool IniImage_Write(const IniImage* image, FILE* fp, const char* name)
+{
+	size_t elementCount = 0;
+	size_t i;
+
+	if (!image || !fp || !name)
+		return false;
+
+	fputs("/* Generated by IniImage_Write(), do not edit. */\n\n", fp);
+	fputs("#include \"IniFile.h\"\n\n", fp);
+
+	for (i = 0; i < image->itemCount; ++i)
+		elementCount += image->items[i].elementCount;
+
+	if (elementCount)
+	{
+		fprintf(fp, "static const IniSpan %s_elements[] =\n{\n", name);
+
+		for (i = 0; i < image->itemCount; ++i)
+		{
+			const IniImageItem* item = &image->items[i];
+			size_t j;
+
+			for (j = 0; j < item->elementCount; ++j)
+			{
+				fputs("\t{ ", fp);
+				__IniImage_WriteString(fp, item->elements[j].data,
+					item->elements[j].length);
+				fprintf(fp, ", %lu },\n", (unsigned long)item->elements[j].length);
+			}
+		}
+
+		fputs("};\n\n", fp);
+	}
+
+	fprintf(fp, "static const IniImageSection %s_sections[] =\n{\n", name);
+
+	for (i = 0; i < image->sectionCount; ++i)
+	{
+		const IniImageSection* section = &image->sections[i];
+
+		fputs("\t{ ", fp);
+		__IniImage_WriteString(fp, section->name, section->nameLength);
+		fprintf(fp, ", %lu, %lu, %lu },\n", (unsigned long)section->nameLength,
+			(unsigned long)section->firstItem, (unsigned long)section->itemCount);
+	}
+
+	fputs("};\n\n", fp);
+
+	if (image->itemCount)
+	{
+		size_t element = 0;
+
+		fprintf(fp, "static const IniImageItem %s_items[] =\n{\n", name);
+
+		for (i = 0; i < image->itemCount; ++i)
+		{
+			const IniImageItem* item = &image->items[i];
+
+			fputs("\t{ ", fp);
+			__IniImage_WriteString(fp, item->key, item->keyLength);
+			fprintf(fp, ", %lu, ", (unsigned long)item->keyLength);
+			__IniImage_WriteString(fp, item->value, item->valueLength);
+			fprintf(fp, ", %lu, %lu, ", (unsigned long)item->valueLength,
+				(unsigned long)item->section);
+
+			if (item->elementCount)
+				fprintf(fp, "%s_elements + %lu", name, (unsigned long)element);
+			else
+				fputs("NULL", fp);
+
+			fprintf(fp, ", %lu },\n", (unsigned long)item->elementCount);
+
+			element += item->elementCount;
+		}
+
+		fputs("};\n\n", fp);
+	}
+
+	__IniImage_WriteTable(fp, name, "seeds", image->seeds, image->seedCount);
+	__IniImage_WriteTable(fp, name, "slots", image->slots, image->slotCount);
+
+	fprintf(fp, "const IniImage %s =\n{\n", name);
+	fprintf(fp, "\t%s_sections, %lu,\n", name,
+		(unsigned long)image->sectionCount);
+
+	if (image->itemCount)
+		fprintf(fp, "\t%s_items, %lu,\n", name, (unsigned long)image->itemCount);
+	else
+		fputs("\tNULL, 0,\n", fp);
+
+	fprintf(fp, "\t%s_seeds, %lu,\n", name, (unsigned long)image->seedCount);
+	fprintf(fp, "\t%s_slots, %lu\n", name, (unsigned long)image->slotCount);
+	fputs("};\n", fp);
+
+	if (ferror(fp))
+	{
+		__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_FWRITE_FAIL, errno);
+
+		return false;
+	}
+
+	return true;
+}
+
+const IniImageItem* IniImage_Find(const IniImage* image, const char* section,
+	const char* key)
+{
+	const IniImageItem* item = NULL;
+	const IniImageSection* owner = NULL;
+	size_t sectionLength = 0;
+	size_t keyLength = 0;
+	uint32_t hash = 0;
+	uint32_t position = 0;
+
+	if (!image || !key || !image->itemCount)
+		return NULL;
+
+	if (!section)
+		section = "";
+
+	sectionLength = strlen(section);
+	keyLength = strlen(key);
+
+	hash = __IniImage_Hash(section, sectionLength, key, keyLength);
+	position = image->slots[__IniImage_Slot(hash,
+		image->seeds[__IniImage_Bucket(hash, image->seedCount)],
+		image->slotCount)];
+
+	if (position == DM_INI_IMAGE_EMPTY)
+		return NULL;
+
+	item = &image->items[position];
+	owner = &image->sections[item->section];
+
+	if (item->keyLength != keyLength ||
+		memcmp(item->key, key, keyLength) != 0 ||
+		owner->nameLength != sectionLength ||
+		memcmp(owner->name, section, sectionLength) != 0)
+	{
+		return NULL;
+	}
+
+	return item;
+}
+
+const char* IniImage_GetValue(const IniImage* image, const char* section,
+	const char* key)
+{
+	const IniImageItem* item = IniImage_Find(image, section, key);
+
+	return item ? item->value : NULL;
 }
@@ -15,10 +15,17 @@
  */
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
 
 #ifndef HYPE_INI_FILE_H_
 #define HYPE_INI_FILE_H_
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 // Max buffer size for each line.
 // Can be modified for the needs of the application.
 #define DM_INI_MAX_LINE_BUFFER 2048
@@ -35,6 +42,15 @@
 // Segment of a block comment.
 #define DM_INI_COMMENT_4 '*'
 
+// Size of each block handed out by the per-file arena.
+#define DM_INI_ARENA_BLOCK_SIZE 16384
+
+// A trailing backslash continues a value on the next line.
+#define DM_INI_LINE_CONTINUATION '\\'
+
+// Quotes a value so it can hold escape sequences and leading spaces.
+#define DM_INI_QUOTE '"'
+
 // [
 #define DM_LEFT_BRACKET '['
 
@@ -43,11 +59,42 @@
 
 #define DM_INI_ERROR_MESSAGE_FOPEN_FAIL "File open failed! Check errno"
 #define DM_INI_ERROR_MESSAGE_MALLOC_FAIL "malloc failed! Check errno"
+#define DM_INI_ERROR_MESSAGE_FREAD_FAIL "File read failed! Check errno"
+#define DM_INI_ERROR_MESSAGE_FWRITE_FAIL "File write failed! Check errno"
+#define DM_INI_ERROR_MESSAGE_UNTERMINATED_COMMENT "Block comment is never closed"
+#define DM_INI_ERROR_MESSAGE_BAD_SECTION "Section declaration is missing ']'"
+#define DM_INI_ERROR_MESSAGE_BAD_ITEM "Item is missing its '=' separator"
+#define DM_INI_ERROR_MESSAGE_UNTERMINATED_QUOTE "Quoted value is never closed"
+#define DM_INI_ERROR_MESSAGE_BAD_QUOTE "Unexpected text after a quoted value"
+#define DM_INI_ERROR_MESSAGE_IMAGE_COLLISION "Two keys hash the same, no perfect hash exists"
+#define DM_INI_ERROR_MESSAGE_BAD_VALUE "Value does not fit the type asked for"
+#define DM_INI_ERROR_MESSAGE_BAD_UTF8 "Text is not valid UTF-8"
+#define DM_INI_ERROR_MESSAGE_BAD_UTF16 "Text is not valid UTF-16"
+#define DM_INI_ERROR_MESSAGE_UTF16_TEXT "UTF-16 text has to be converted to UTF-8 first"
+#define DM_INI_ERROR_MESSAGE_BAD_DIALECT "Dialect gives a character two meanings"
+#define DM_INI_ERROR_MESSAGE_DUPLICATE_KEY "Key appears twice in one section"
+
+// Error codes for problems found in the contents of a file.
+#define DM_INI_ERROR_CODE_UNTERMINATED_COMMENT 101
+#define DM_INI_ERROR_CODE_BAD_SECTION 102
+#define DM_INI_ERROR_CODE_BAD_ITEM 103
+#define DM_INI_ERROR_CODE_UNTERMINATED_QUOTE 104
+#define DM_INI_ERROR_CODE_BAD_QUOTE 105
+#define DM_INI_ERROR_CODE_IMAGE_COLLISION 106
+#define DM_INI_ERROR_CODE_BAD_VALUE 107
+#define DM_INI_ERROR_CODE_BAD_UTF8 108
+#define DM_INI_ERROR_CODE_BAD_UTF16 109
+#define DM_INI_ERROR_CODE_BAD_DIALECT 110
+#define DM_INI_ERROR_CODE_DUPLICATE_KEY 111
+
+// errorOffset of a problem that is not about a place in the text.
+#define DM_INI_NO_OFFSET SIZE_MAX
 
 /**
  * @brief A helping hand if/when you get errors.
  *
- * Structure that contains an error message to help out the developer.
+ * Structure that contains an error message to help out the developer. Each
+ * thread has its own, so files can be read on several threads at once.
  */
 typedef struct
 {
@@ -56,21 +103,118 @@ typedef struct
 
 	/* The error code that caused the message. */
 	int errorCode;
-} IniErrorHint;
 
-static bool __IniFile_GlobalCommentState = false;
-static IniErrorHint* __IniFile_ErrorHint;
+	/* Byte offset into the parsed text where the problem was found, or
+	 * DM_INI_NO_OFFSET. */
+	size_t errorOffset;
+
+	/* Line and byte column of errorOffset, both counted from 1. 0 when the
+	 * problem is not about a place in the text. */
+	size_t errorLine;
+	size_t errorColumn;
+} IniErrorHint;
 
 void __IniFile_SetErrorHint(const char* message, int code);
+void __IniFile_SetErrorHintAt(const char* message, int code, size_t offset);
 void __IniFile_ClearErrorHint();
 
 long __IniFile_Hash(const char* str);
 
+/**
+ * @brief Hashes a run of bytes the same way as __IniFile_Hash().
+ *
+ * This is the full 32-bit value used by the lookup indexes, before it is
+ * reduced by HASH_SIZE.
+ */
+uint32_t __IniFile_HashSpan(const char* data, size_t length);
+
 /**
  * @brief Grabs the latest error from this library.
  */
 IniErrorHint* IniFile_GetErrorHint();
 
+/**
+ * @brief A run of bytes inside a buffer, not null terminated.
+ */
+typedef struct
+{
+	const char* data;
+	size_t length;
+} IniSpan;
+
+// The value was written between quotes, which are not part of the span.
+#define DM_INI_VALUE_QUOTED 0x1
+
+// The quoted value contains escape sequences that still need decoding.
+#define DM_INI_VALUE_ESCAPED 0x2
+
+// The item was collected from repeated "key[]" items.
+#define DM_INI_VALUE_ARRAY 0x4
+
+// Separates the elements of a list value.
+#define DM_INI_LIST_SEPARATOR ','
+
+/**
+ * @brief A value as it appears in the source buffer.
+ *
+ * A value continued over several lines is made up of one span per line.
+ * Joining the spans, or decoding the escapes of a quoted value, is left until
+ * someone actually needs the whole string.
+ */
+typedef struct
+{
+	const IniSpan* spans;
+	size_t spanCount;
+
+	/* DM_INI_VALUE_* flags. */
+	unsigned int flags;
+} IniValue;
+
+/**
+ * @brief Produces the final bytes of a value.
+ *
+ * Lines continued with a trailing backslash are joined directly, lines
+ * continued by indentation are joined with a newline. Escape sequences in
+ * quoted values are decoded.
+ *
+ * @param value The value to join.
+ * @param destination Receives the joined bytes, without a null terminator.
+ * Pass NULL to only measure the result.
+ * @return Returns the length of the joined value.
+ */
+size_t IniValue_Join(const IniValue* value, char* destination);
+
+/**
+ * @brief Converts a value to a decimal integer.
+ *
+ * @return Returns false if the value is not a whole number in range, with
+ * the reason in IniFile_GetErrorHint().
+ */
+bool IniValue_ToLong(const IniValue* value, long* result);
+
+/**
+ * @brief Converts a value to a floating point number.
+ *
+ * @return Returns false if the value is not a number.
+ */
+bool IniValue_ToDouble(const IniValue* value, double* result);
+
+/**
+ * @brief Converts true, yes, on or 1 and false, no, off or 0 to a bool.
+ *
+ * @return Returns false for any other value.
+ */
+bool IniValue_ToBool(const IniValue* value, bool* result);
+
+/**
+ * @brief Joins a value into a fixed size, null terminated string.
+ *
+ * @param size Size of destination including the terminator.
+ * @return Returns false, leaving destination alone, if the value does not
+ * fit.
+ */
+bool IniValue_ToString(const IniValue* value, char* destination, size_t size);
+
 /**
  * @brief The basic data structure of an ini file.
  *
@@ -81,8 +225,28 @@ typedef struct
 	/* The lookup value for the item. */
 	const char* key;
 
-	/* The value that the item contains. */
+	/* The value that the item contains. NULL for a value continued over
+	 * several lines until IniFile_GetValue() joins it. */
 	const char* value;
+
+	size_t keyLength;
+	size_t valueLength;
+
+	/* The raw source spans while value is NULL, otherwise NULL. */
+	const IniSpan* spans;
+	size_t spanCount;
+
+	/* Elements of the value as an array, NULL until first needed. */
+	IniSpan* elements;
+	size_t elementCount;
+	size_t elementCapacity;
+
+	/* DM_INI_VALUE_* flags from the parser. */
+	unsigned int flags;
+
+	/* Cached __IniFile_HashSpan() of the key, next to flags so the two share
+	 * one word instead of each being padded out. */
+	uint32_t hash;
 } IniItem;
 
 /**
@@ -104,6 +268,74 @@ IniItem* IniItem_Initialize();
  */
 void IniItem_Free(IniItem* item);
 
+/**
+ * @brief Number of source spans that make up the value of an item.
+ */
+size_t IniItem_GetSpanCount(const IniItem* item);
+
+/**
+ * @brief Gets one of the source spans of an item's value without copying.
+ *
+ * For values with escape sequences this is the text as written, before
+ * decoding.
+ */
+IniSpan IniItem_GetSpan(const IniItem* item, size_t index);
+
+/**
+ * @brief Where an IniFile gets its memory from, instead of malloc and free.
+ *
+ * Blocks handed out must be aligned for any type, like malloc's. deallocate
+ * is told the size that was asked for, and may be NULL for allocators that
+ * release everything at once.
+ */
+typedef struct
+{
+	void* (*allocate)(void* user, size_t size);
+	void (*deallocate)(void* user, void* pointer, size_t size);
+
+	/* Passed to both callbacks. */
+	void* user;
+} IniAllocator;
+
+void* __IniAllocator_Allocate(const IniAllocator* allocator, size_t size);
+void* __IniAllocator_Reallocate(const IniAllocator* allocator, void* pointer,
+	size_t size);
+void __IniAllocator_Free(const IniAllocator* allocator, void* pointer);
+
+typedef struct IniArenaBlock IniArenaBlock;
+
+/**
+ * @brief Bump allocator for memory that lives as long as its IniFile.
+ */
+typedef struct
+{
+	IniArenaBlock* head;
+
+	/* Where blocks come from, NULL for malloc. */
+	const IniAllocator* allocator;
+} IniArena;
+
+void* __IniArena_Allocate(IniArena* arena, size_t size);
+void __IniArena_Free(IniArena* arena);
+
+// Index slot left behind by a removed entry, probing carries on past it.
+#define DM_INI_INDEX_TOMBSTONE UINT32_MAX
+
+/**
+ * @brief Open addressing hash table of positions in a list.
+ *
+ * Each slot holds a position plus one, zero marks an empty slot and
+ * DM_INI_INDEX_TOMBSTONE a removed one.
+ */
+typedef struct
+{
+	uint32_t* slots;
+	size_t capacity;
+
+	/* Slots in use, including tombstones. */
+	size_t count;
+} IniIndex;
+
 /**
  * @brief A named collection of IniItem's.
  *
@@ -117,8 +349,31 @@ typedef struct
 
 	/* Start of the list of items. */
 	IniItem* itemList;
+
+	size_t itemCount;
+	size_t itemCapacity;
+
+	/* Finds items by key. */
+	IniIndex index;
+
+	/* Item positions ordered by key, valid while sorted is true. */
+	uint32_t* sortedItems;
+	bool sorted;
+
+	/* Cached __IniFile_HashSpan() of the name, for the file's section index. */
+	uint32_t hash;
+
+	/* Where the lists come from, NULL for malloc. */
+	const IniAllocator* allocator;
 } IniSection;
 
+/**
+ * @brief Called for each item found by a query.
+ *
+ * @return Return false to stop the query early.
+ */
+typedef bool (*IniItemCallback)(void* user, IniItem* item);
+
 /**
  * @brief Initialized a IniSection.
  *
@@ -139,6 +394,99 @@ IniSection* IniSection_Initialize();
  */
 void IniSection_Free(IniSection* section);
 
+/**
+ * @brief Number of items in a section.
+ */
+size_t IniSection_ItemCount(const IniSection* section);
+
+/**
+ * @brief Gets an item by its position in the section.
+ *
+ * Items are stored contiguously in file order, so walking every position
+ * from 0 to IniSection_ItemCount() is the quickest way to visit them all.
+ *
+ * @return Returns the item or NULL if index is out of range.
+ */
+IniItem* IniSection_ItemAt(IniSection* section, size_t index);
+
+/**
+ * @brief Visits the items of a section in key order.
+ *
+ * Keys are compared byte by byte. Items with equal keys keep their file
+ * order. The order is worked out once and reused until the section changes.
+ *
+ * @return Returns false if memory for the ordering ran out.
+ */
+bool IniSection_ForEachSorted(IniSection* section, IniItemCallback callback,
+	void* user);
+
+/**
+ * @brief Visits the items whose keys fall in [lo, hi), in key order.
+ *
+ * @param lo Smallest key to visit, or NULL to start from the first key.
+ * @param hi Key to stop before, or NULL to run to the last key.
+ * @return Returns false if memory for the ordering ran out.
+ */
+bool IniSection_Range(IniSection* section, const char* lo, const char* hi,
+	IniItemCallback callback, void* user);
+
+// Separates the levels of a hierarchical section name like "db.primary".
+#define DM_INI_PATH_SEPARATOR '.'
+
+/**
+ * @brief One level of a dotted section name.
+ *
+ * Node 0 is the root and has an empty name.
+ */
+typedef struct
+{
+	/* This level's part of the name, e.g. "primary" in "db.primary.pool". */
+	const char* name;
+	size_t nameLength;
+
+	/* Offset just past this level in the full dotted name. */
+	size_t pathLength;
+
+	uint32_t parent;
+	uint32_t firstChild;
+	uint32_t lastChild;
+	uint32_t nextSibling;
+
+	/* Position in IniFile.sectionList, or UINT32_MAX if no section has
+	 * exactly this name. */
+	uint32_t section;
+
+	uint32_t hash;
+} IniTreeNode;
+
+/**
+ * @brief Sections arranged by their dotted names.
+ *
+ * Built the first time a hierarchical query needs it. Children are found
+ * through a hash on (parent, name), so walking a path costs time in the
+ * length of the path, not the number of sections.
+ */
+typedef struct
+{
+	IniTreeNode* nodes;
+	size_t nodeCount;
+	size_t nodeCapacity;
+
+	IniIndex index;
+
+	bool built;
+
+	/* Where the nodes come from, NULL for malloc. */
+	const IniAllocator* allocator;
+} IniSectionTree;
+
+/**
+ * @brief Called for each section found by a query.
+ *
+ * @return Return false to stop the query early.
+ */
+typedef bool (*IniSectionCallback)(void* user, IniSection* section);
+
 /**
  * @brief This is a basic representation of an Ini file.
  *
@@ -148,16 +496,758 @@ void IniSection_Free(IniSection* section);
  */
 typedef struct
 {
-	IniItem* globalList;
+	/* Items that come before the first section, its name is NULL. */
+	IniSection globalSection;
+
 	IniSection* sectionList;
+	size_t sectionCount;
+	size_t sectionCapacity;
+
+	/* Finds sections by name, so a reopened section costs one probe. */
+	IniIndex sectionIndex;
+
+	/* The source text, which item keys and values point into. */
+	char* buffer;
+	size_t bufferLength;
+
+	/* Joined values and other memory that lives as long as the file. */
+	IniArena arena;
+
+	/* Dotted section names, see IniFile_ForEachUnder(). */
+	IniSectionTree tree;
+
+	/* Section positions ordered by name, valid while sorted is true. */
+	uint32_t* sortedSections;
+	bool sorted;
+
+	/* Where all of the above comes from, allocate is NULL for malloc. */
+	IniAllocator allocator;
 } IniFile;
 
+/**
+ * @brief The syntax a file is written in.
+ *
+ * Use IniDialect_SetDefaults(), change the fields that differ and then call
+ * IniDialect_Compile() once. A compiled dialect is read only and can be
+ * shared by any number of parses at the same time.
+ */
+typedef struct
+{
+	/* Characters that start a comment line, "#;" by default. */
+	const char* commentPrefixes;
+
+	/* Characters that end a key, "=" by default. Python's configparser
+	 * takes "=:". */
+	const char* separators;
+
+	/* Characters other than line breaks that are whitespace, " \t\v\f" by
+	 * default. */
+	const char* whitespace;
+
+	/* The brackets around section names, '[' and ']' by default. */
+	char sectionOpen;
+	char sectionClose;
+
+	/* Whether "//" starts a comment line and "/" "*" a block comment. On by
+	 * default. */
+	bool slashComments;
+
+	/* Whether a comment prefix after whitespace ends an unquoted value, as in
+	 * "port = 80 ; http". Off by default. */
+	bool inlineComments;
+
+	/* Filled in by IniDialect_Compile(), what each byte means. */
+	unsigned char classes[256];
+
+	/* The only separator, 0 if there are several. */
+	char separator;
+
+	/* Whether space and tab are both whitespace, so that runs of them can be
+	 * skipped 16 bytes at a time. */
+	bool wideSpace;
+} IniDialect;
+
+/**
+ * @brief Fills in the dialect this library has always read, compiled.
+ *
+ * @param dialect A non-null pointer to the dialect to initialize.
+ */
+void IniDialect_SetDefaults(IniDialect* dialect);
+
+/**
+ * @brief Builds the byte classification table of a dialect.
+ *
+ * @param dialect The dialect, with its descriptive fields filled in.
+ * @return Returns false if a character is given two meanings or a field is
+ * empty.
+ * @note Any errors will be written to IniFile_GetErrorHint().
+ */
+bool IniDialect_Compile(IniDialect* dialect);
+
+/**
+ * @brief What reading a file into an IniFile does with a key that appears
+ * more than once in a section.
+ *
+ * Repeated "key[]" items always build an array and are not duplicates.
+ */
+typedef enum
+{
+	/* Later values are dropped. */
+	IniDuplicate_FirstWins = 0,
+
+	/* Later values replace earlier ones. */
+	IniDuplicate_LastWins,
+
+	/* All values are kept as an array, see IniFile_GetArray(). */
+	IniDuplicate_Collect,
+
+	/* The read fails with DM_INI_ERROR_CODE_DUPLICATE_KEY. */
+	IniDuplicate_Error
+} IniDuplicateKeys;
+
+/**
+ * @brief Knobs that change how a file is parsed.
+ *
+ * Use IniOptions_SetDefaults() before changing individual fields so that
+ * options added later get sensible values.
+ */
+typedef struct
+{
+	/* Allow block comments to contain other block comments. */
+	bool nestedComments;
+
+	/* A value ending in a backslash continues on the next line. */
+	bool lineContinuation;
+
+	/* Indented lines after an item continue its value, like Python's
+	 * configparser. Off by default since many files indent their items. */
+	bool indentedContinuation;
+
+	/* Skip a UTF-8 byte order mark at the start of the text. On by default. */
+	bool skipBom;
+
+	/* Fail with DM_INI_ERROR_CODE_BAD_UTF8, at the offset of the first bad
+	 * sequence, on text that is not valid UTF-8. Off by default. The scans
+	 * for line and comment ends note the first non-ASCII byte, and only
+	 * text from there on is read again. */
+	bool validateUtf8;
+
+	/* A compiled dialect to read instead of the usual syntax, NULL for the
+	 * default. Must outlive the parse. */
+	const IniDialect* dialect;
+
+	/* What happens to repeated keys, IniDuplicate_FirstWins by default.
+	 * IniFile_Parse() reports every item whatever this says. */
+	IniDuplicateKeys duplicateKeys;
+
+	/* Where the file and everything in it is allocated, NULL for malloc.
+	 * Copied, so it only needs to live until the read returns. */
+	const IniAllocator* allocator;
+} IniOptions;
+
+/**
+ * @brief Callbacks for the streaming parser.
+ *
+ * Any callback may be NULL. Returning false from a callback stops the parse.
+ * Spans point into the buffer being parsed and are only valid as long as it
+ * is.
+ */
+typedef struct
+{
+	bool (*onSection)(void* user, IniSpan name);
+	bool (*onItem)(void* user, IniSpan key, const IniValue* value);
+} IniHandler;
+
+/**
+ * @brief Fills in the default parsing options.
+ *
+ * @param options A non-null pointer to the options to initialize.
+ */
+void IniOptions_SetDefaults(IniOptions* options);
+
 IniFile* IniFile_ReadFile(const char* filename);
 
+/**
+ * @brief Reads an ini file using the given parsing options.
+ *
+ * A file that starts with a UTF-16 byte order mark is converted to UTF-8
+ * as it is read.
+ *
+ * @param filename Path of the file to read.
+ * @param options Parsing options, or NULL for the defaults.
+ * @note Any errors will be written to IniFile_GetErrorHint(). Offsets of
+ * errors in converted text are into the UTF-8.
+ */
+IniFile* IniFile_ReadFileWithOptions(const char* filename,
+	const IniOptions* options);
+
+/**
+ * @brief Every problem found by IniFile_ReadWithDiagnostics(), in file order.
+ */
+typedef struct
+{
+	IniErrorHint* list;
+	size_t count;
+	size_t capacity;
+
+	/* Where list comes from, allocate is NULL for malloc. */
+	IniAllocator allocator;
+} IniDiagnostics;
+
+/**
+ * @brief Reads an ini file, carrying on past problems in its contents.
+ *
+ * A bad line is recorded and skipped and parsing picks up again on the next
+ * line, so one pass finds every problem. Whatever could be read is returned
+ * even if there were problems.
+ *
+ * @param filename Path of the file to read.
+ * @param options Parsing options, or NULL for the defaults.
+ * @param diagnostics Filled in from scratch with the problems found. Free it
+ * with IniDiagnostics_Free() whatever the result.
+ * @return Returns NULL only if the file could not be read at all, or memory
+ * ran out.
+ * @note Any errors will be written to IniFile_GetErrorHint().
+ */
+IniFile* IniFile_ReadWithDiagnostics(const char* filename,
+	const IniOptions* options, IniDiagnostics* diagnostics);
+
+void IniDiagnostics_Free(IniDiagnostics* diagnostics);
+
+/**
+ * @brief Reads ini data that is already in memory.
+ *
+ * The data is copied, so it does not need to outlive the IniFile. Data
+ * that starts with a UTF-16 byte order mark is converted to UTF-8.
+ *
+ * @param data The contents of an ini file, does not need to be null
+ * terminated.
+ * @param length Number of bytes in data.
+ * @param options Parsing options, or NULL for the defaults.
+ * @note Any errors will be written to IniFile_GetErrorHint().
+ */
+IniFile* IniFile_ReadBuffer(const char* data, size_t length,
+	const IniOptions* options);
+
 void IniFile_Free(IniFile* file);
 
+/**
+ * @brief Finds a section by name.
+ *
+ * @param name Name of the section, NULL for the global items.
+ * @return Returns the section or NULL if there is no such section.
+ */
+IniSection* IniFile_GetSection(IniFile* file, const char* name);
+
+/**
+ * @brief Number of named sections, not counting the global items.
+ */
+size_t IniFile_SectionCount(const IniFile* file);
+
+/**
+ * @brief Gets a named section by its position in the file.
+ *
+ * @return Returns the section or NULL if index is out of range.
+ */
+IniSection* IniFile_SectionAt(IniFile* file, size_t index);
+
+/**
+ * @brief Finds an item.
+ *
+ * @param section Name of the section, NULL for the global items.
+ * @param key Key of the item.
+ * @return Returns the item or NULL if there is no such item.
+ */
+IniItem* IniFile_GetItem(IniFile* file, const char* section, const char* key);
+
+/**
+ * @brief A key with its hash worked out ahead of time.
+ *
+ * Make one with IniKey_Make() for keys that are looked up often, so each
+ * lookup skips measuring and hashing the key.
+ */
+typedef struct
+{
+	const char* data;
+	size_t length;
+
+	/* __IniFile_HashSpan() of the key. */
+	uint32_t hash;
+} IniKey;
+
+/**
+ * @brief Makes a lookup handle for a key. The key is not copied.
+ */
+IniKey IniKey_Make(const char* data, size_t length);
+
+/**
+ * @brief Finds a section by a name that does not need to be null terminated.
+ *
+ * @param name Name of the section, NULL for the global items.
+ * @return Returns the section or NULL if there is no such section.
+ */
+IniSection* IniFile_FindSection(IniFile* file, const char* name,
+	size_t length);
+
+/**
+ * @brief Finds an item in a section by a precomputed key.
+ *
+ * @return Returns the item or NULL if there is no such item.
+ */
+IniItem* IniSection_Find(IniSection* section, const IniKey* key);
+
+/**
+ * @brief Gets the value of an item found by other means as a null terminated
+ * string.
+ *
+ * @see IniFile_GetValue()
+ */
+const char* IniFile_GetItemValue(IniFile* file, IniItem* item);
+
+/**
+ * @brief Gets the value of an item as a null terminated string.
+ *
+ * Values continued over several lines or containing escape sequences are
+ * joined or decoded into the file's arena the first time they are asked for;
+ * everything else is returned without copying.
+ *
+ * @return Returns the value or NULL if there is no such item.
+ */
+const char* IniFile_GetValue(IniFile* file, const char* section,
+	const char* key);
+
+/**
+ * @brief Sets the value of an item, adding the item and its section if
+ * needed.
+ *
+ * The key, section name and value are copied. An existing value is
+ * overwritten in place when the new one fits, otherwise the copy goes to the
+ * file's arena and the old value is not reclaimed until the file is freed.
+ * Setting an array item makes it a plain value again.
+ *
+ * @param section Name of the section, NULL for the global items.
+ * @return Returns the item or NULL if memory ran out.
+ * @note Item and section pointers obtained earlier may be invalidated by
+ * adding items or sections.
+ * @note Any errors will be written to IniFile_GetErrorHint().
+ */
+IniItem* IniFile_Set(IniFile* file, const char* section, const char* key,
+	const char* value);
+
+/**
+ * @brief Removes an item.
+ *
+ * The last item of the section takes the removed item's place, so removing
+ * changes the file order of the section's items. Pointers to the moved item
+ * are invalidated.
+ *
+ * @param section Name of the section, NULL for the global items.
+ * @return Returns false if there is no such item.
+ */
+bool IniFile_Remove(IniFile* file, const char* section, const char* key);
+
+/**
+ * @brief Finds a section by name, adding an empty one if there is none.
+ *
+ * @return Returns the section or NULL if memory ran out.
+ * @note Section pointers obtained earlier may be invalidated.
+ * @note Any errors will be written to IniFile_GetErrorHint().
+ */
+IniSection* IniFile_AddSection(IniFile* file, const char* name);
+
+/**
+ * @brief Removes a section and all its items.
+ *
+ * Like IniFile_Remove() the last section takes the removed one's place. The
+ * global section can not be removed.
+ *
+ * @return Returns false if there is no such section.
+ */
+bool IniFile_RemoveSection(IniFile* file, const char* name);
+
+/**
+ * @brief Parses a buffer without building an IniFile.
+ *
+ * Reports every section and item to the handler as it is found. Block
+ * comments are skipped in one jump rather than line by line.
+ *
+ * A buffer that starts with a UTF-16 byte order mark is converted to UTF-8
+ * first, as IniFile_ReadBuffer() does. The spans given to the handler and
+ * error offsets then refer to the converted text, which is freed before
+ * this returns.
+ *
+ * @param buffer The contents of an ini file, does not need to be null
+ * terminated.
+ * @param length Number of bytes in buffer.
+ * @param options Parsing options, or NULL for the defaults.
+ * @param handler Callbacks to receive the contents, may be NULL.
+ * @param user Passed to every callback.
+ * @return Returns true if the whole buffer was parsed. On a syntax error the
+ * reason is written to IniFile_GetErrorHint(), if a callback stopped the
+ * parse the hint is left clear.
+ */
+bool IniFile_Parse(const char* buffer, size_t length,
+	const IniOptions* options, const IniHandler* handler, void* user);
+
+/**
+ * @brief Finds the items of one section in ini text without parsing them.
+ *
+ * Every line is still found and classified as IniFile_Parse() would, so
+ * that block comments and continued values can not hide a declaration.
+ * What is skipped is the rest of the work: no item is split into key and
+ * value, unquoted or unescaped, and nothing is copied or allocated. The
+ * section found can then be handed to IniFile_Parse() on its own.
+ *
+ * A section declared several times is found once per declaration. Search
+ * the remainder of buffer after text to find the next.
+ *
+ * text points into buffer, so UTF-16 is not converted. Pass it through
+ * __IniFile_DecodeUtf16() first.
+ *
+ * @param name Name of the section, or NULL for the global items before
+ * the first declaration.
+ * @param text Receives the lines between the declaration and the next one.
+ * @return Returns false if the section is not declared. Also returns false on
+ * an unterminated block comment or UTF-16 text, with the reason in
+ * IniFile_GetErrorHint().
+ */
+bool IniFile_FindSectionText(const char* buffer, size_t length,
+	const char* name, size_t nameLength, const IniOptions* options,
+	IniSpan* text);
+
+/**
+ * @brief Gets the value of an item as an array.
+ *
+ * Items written as "key[]=a" several times are collected into one array
+ * while parsing. Any other value is split on DM_INI_LIST_SEPARATOR with
+ * surrounding whitespace trimmed, except quoted values which are always a
+ * single element. The split happens once, later calls return the cached
+ * elements.
+ *
+ * @param elements Receives the elements, which stay valid as long as file.
+ * @param count Receives the number of elements.
+ * @return Returns false if there is no such item.
+ */
+bool IniFile_GetArray(IniFile* file, const char* section, const char* key,
+	const IniSpan** elements, size_t* count);
+
+// Write sections and items ordered by name instead of in file order.
+#define DM_INI_WRITE_SORTED 0x1
+
+/**
+ * @brief Writes a file out as ini text.
+ *
+ * Values that would not read back the same, such as ones with leading
+ * spaces or newlines, are quoted and escaped. Comments are not kept.
+ *
+ * @param fp Stream to write to.
+ * @param flags DM_INI_WRITE_* flags.
+ * @return Returns false on failure.
+ * @note Any errors will be written to IniFile_GetErrorHint().
+ */
+bool IniFile_Write(IniFile* file, FILE* fp, unsigned int flags);
+
+/**
+ * @brief Writes a file out as ini text to the named file.
+ *
+ * @see IniFile_Write()
+ */
+bool IniFile_WriteFile(IniFile* file, const char* filename,
+	unsigned int flags);
+
+// Write JSON Lines, one object per item, instead of a single object.
+#define DM_INI_JSON_LINES 0x1
+
+/**
+ * @brief Converts ini text to JSON as it is parsed, without building an
+ * IniFile.
+ *
+ * By default writes a single object holding the global items, with each
+ * section as a nested object in file order:
+ * {"key":"value","server":{"port":"80"}}. Nothing is merged, so a section
+ * declared twice appears twice. Consecutive "key[]" items become an array.
+ *
+ * With DM_INI_JSON_LINES each item is written as its own line, such as
+ * {"section":"server","key":"port","value":"80"}, with a null section for
+ * the global items.
+ *
+ * Values are always strings. Output is gathered in one fixed size buffer.
+ * UTF-16 is converted as in IniFile_Parse().
+ *
+ * @param flags DM_INI_JSON_* flags.
+ * @return Returns false on a syntax error or when writing fails.
+ * @note Any errors will be written to IniFile_GetErrorHint().
+ */
+bool IniFile_ParseToJson(const char* buffer, size_t length,
+	const IniOptions* options, unsigned int flags, FILE* fp);
+
+/**
+ * @brief Visits every section at or below a dotted path.
+ *
+ * "db" visits [db] and everything under it such as [db.primary.pool], while
+ * "db." only visits what is under it. Prefixes match whole levels, so "db"
+ * does not visit [dbx]. Sections are visited depth first in file order.
+ *
+ * @param prefix Dotted path to start from, "" visits every section.
+ * @param callback Called for each section, may return false to stop.
+ * @param user Passed to callback.
+ * @return Returns false if memory for the section tree ran out.
+ */
+bool IniFile_ForEachUnder(IniFile* file, const char* prefix,
+	IniSectionCallback callback, void* user);
+
+/**
+ * @brief Finds an item by its full dotted path.
+ *
+ * "db.primary.pool.size" is the item "size" in [db.primary.pool]. When
+ * several splits are possible the longest section name wins, so keys may
+ * contain dots too.
+ *
+ * @return Returns the item or NULL if there is no such item.
+ */
+IniItem* IniFile_GetPath(IniFile* file, const char* path);
+
+/**
+ * @brief A section of an IniImage. Its items are stored next to each other.
+ */
+typedef struct
+{
+	const char* name;
+	size_t nameLength;
+
+	size_t firstItem;
+	size_t itemCount;
+} IniImageSection;
+
+/**
+ * @brief An item of an IniImage with its value already joined and decoded.
+ */
+typedef struct
+{
+	const char* key;
+	size_t keyLength;
+
+	const char* value;
+	size_t valueLength;
+
+	/* Position of the item's section in IniImage.sections. */
+	size_t section;
+
+	/* Elements of "key[]" arrays, NULL for other values. */
+	const IniSpan* elements;
+	size_t elementCount;
+} IniImageItem;
+
+/**
+ * @brief A read only ini file laid out as plain tables.
+ *
+ * ini2c writes these out as C source, so that a configuration compiled into
+ * a program can be looked up without parsing it at startup. Items are found
+ * through a perfect hash on their section and key: each bucket of keys has a
+ * seed that sends every key in it to a slot of its own, so a lookup is two
+ * hashes and one compare.
+ */
+typedef struct
+{
+	/* Section 0 holds the global items and has an empty name. */
+	const IniImageSection* sections;
+	size_t sectionCount;
+
+	const IniImageItem* items;
+	size_t itemCount;
+
+	const uint32_t* seeds;
+	size_t seedCount;
+
+	/* Item positions, DM_INI_IMAGE_EMPTY for unused slots. */
+	const uint32_t* slots;
+	size_t slotCount;
+} IniImage;
+
+// Unused slot in IniImage.slots.
+#define DM_INI_IMAGE_EMPTY UINT32_MAX
+
+/**
+ * @brief Builds an image of a file in memory.
+ *
+ * When a key appears more than once in a section, lookups find the one that
+ * IniFile_GetItem() would.
+ *
+ * @return Returns the image, which points into file and must be freed with
+ * IniImage_Free() before it.
+ * @note Any errors will be written to IniFile_GetErrorHint().
+ */
+IniImage* IniImage_Build(IniFile* file);
+
+/**
+ * @brief Frees an image made by IniImage_Build().
+ */
+void IniImage_Free(IniImage* image);
+
+/**
+ * @brief Writes an image out as C source defining a const IniImage.
+ *
+ * @param name Name of the IniImage variable, other definitions in the
+ * source are static and prefixed with it.
+ * @return Returns false if writing failed.
+ */
+bool IniImage_Write(const IniImage* image, FILE* fp, const char* name);
+
+/**
+ * @brief Finds an item in an image.
+ *
+ * @param section Name of the section, NULL for the global items.
+ * @return Returns the item or NULL if there is no such item.
+ */
+const IniImageItem* IniImage_Find(const IniImage* image, const char* section,
+	const char* key);
+
+/**
+ * @brief Gets the value of an item in an image.
+ *
+ * @return Returns the null terminated value or NULL if there is no such item.
+ */
+const char* IniImage_GetValue(const IniImage* image, const char* section,
+	const char* key);
+
 bool __IniFile_ReadLine(const char* line, IniItem* item, IniItem* section);
 
+/**
+ * @brief What a single line of an ini file turned out to be.
+ */
+typedef enum
+{
+	IniLine_Blank = 0,
+	IniLine_Comment,
+	IniLine_BlockComment,
+	IniLine_Section,
+	IniLine_Item,
+	IniLine_Continuation
+} IniLineType;
+
+/**
+ * @brief The result of classifying a line.
+ *
+ * begin and end are offsets into the line. [begin, end) covers the meaningful
+ * bytes: leading whitespace, trailing whitespace and the line ending are
+ * trimmed off. For blank lines begin == end.
+ */
+typedef struct
+{
+	IniLineType type;
+	size_t begin;
+	size_t end;
+} IniLineInfo;
+
+/**
+ * @brief Classifies a line in a single pass.
+ *
+ * Skips leading whitespace, trims the line ending and works out what kind of
+ * line this is from its first meaningful byte. An item line that starts with
+ * whitespace is reported as IniLine_Continuation.
+ *
+ * @param line The line, which does not need to be null terminated.
+ * @param length Number of bytes in the line, including any line ending.
+ * @param info Optional, receives the type and the meaningful byte offsets.
+ * @return Returns the type of the line.
+ */
+IniLineType __IniFile_ClassifyLine(const char* line, size_t length,
+	IniLineInfo* info);
+
+/**
+ * @brief Lexer state that carries over from one line to the next.
+ *
+ * Lives in whatever is driving the parse rather than in a global so that
+ * several files can be parsed at the same time.
+ */
+typedef struct
+{
+	/* How many block comments are currently open, 0 outside of comments. */
+	unsigned int commentDepth;
+
+	/* Where the outermost open block comment starts, for error messages. */
+	const char* commentStart;
+
+	/* Offset of the first byte with the high bit set in what the last
+	 * __IniParser_SkipBlockComment() consumed, where a UTF-8 check of it
+	 * has to start. */
+	size_t commentHighBit;
+
+	/* Whether a block comment may contain further block comments. */
+	bool nestedComments;
+
+	/* Settings copied from IniOptions. */
+	bool lineContinuation;
+	bool indentedContinuation;
+	bool skipBom;
+	bool validateUtf8;
+	const IniDialect* dialect;
+
+	/* Where problems are recorded to carry on past them, NULL to stop at
+	 * the first. */
+	IniDiagnostics* diagnostics;
+
+	/* Scratch list of spans for the value being continued. */
+	IniSpan* spans;
+	size_t spanCapacity;
+
+	/* Where spans comes from, NULL for malloc. */
+	const IniAllocator* allocator;
+} IniParser;
+
+void __IniParser_Initialize(IniParser* parser, const IniOptions* options);
+void __IniParser_Release(IniParser* parser);
+
+/**
+ * @brief Consumes the body of the block comment the parser is in.
+ *
+ * Stops right after the "*" "/" that closes the outermost comment.
+ *
+ * @return Returns the number of bytes consumed. If this is length, the
+ * comment may still be open; check parser->commentDepth.
+ */
+size_t __IniParser_SkipBlockComment(IniParser* parser, const char* text,
+	size_t length);
+
+/**
+ * @brief Classifies a line while keeping track of block comments.
+ *
+ * Works like __IniFile_ClassifyLine() but skips over block comments that
+ * were opened on earlier lines, open on this line or close partway through
+ * it. The offsets in info describe whatever is left once the comments are
+ * removed. A line made up only of comment is IniLine_Comment.
+ */
+IniLineType __IniParser_ClassifyLine(IniParser* parser, const char* line,
+	size_t length, IniLineInfo* info);
+
+/**
+ * @brief IniFile_Parse() that records problems in diagnostics and carries
+ * on with the next line, unless diagnostics is NULL.
+ */
+bool __IniFile_ParseWithDiagnostics(const char* buffer, size_t length,
+	const IniOptions* options, const IniHandler* handler, void* user,
+	IniDiagnostics* diagnostics);
+
+/**
+ * @brief Whether data starts with a UTF-16 byte order mark.
+ */
+bool __IniFile_HasUtf16Mark(const char* data, size_t length);
+
+/**
+ * @brief Converts data that starts with a UTF-16 byte order mark to UTF-8,
+ * as the readers do.
+ *
+ * @param allocator Where text comes from, NULL for malloc.
+ * @param text Receives the null terminated UTF-8 text, or NULL if data does
+ * not start with a UTF-16 byte order mark and can be used as it is. Release
+ * it with __IniAllocator_Free().
+ * @param textLength Receives the length of text.
+ * @return Returns false if data is not valid UTF-16 or memory ran out, with
+ * the reason in IniFile_GetErrorHint().
+ */
+bool __IniFile_DecodeUtf16(const char* data, size_t length,
+	const IniAllocator* allocator, char** text, size_t* textLength);
+
 bool __IniFile_IsLineCommented(const char* line);
 
 bool __IniFile_IsBeginBlockComment(const char* line);
@@ -169,4 +1259,8 @@ bool __IniFile_IsEndBlockComment(const char* line);
 bool __IniFile_IsSectionDeclaration(const char* line);
 char* __IniFile_GetSectionName(const char* line);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif // HYPE_INI_FILE_H_
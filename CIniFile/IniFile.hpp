@@ -0,0 +1,933 @@
+/**
+ * IniFile.hpp - Optional header only C++17 wrapper around IniFile.h.
+ *
+ * CIniFile: C implementation of reading ini configuration files.
+ * An open source project of HYPEWORKS.
+ *
+ * Copyright (C) 2017-2021 HYPEWORKS Ltd Co.
+ */
+
+/*
+ * This software library is open source and licensed under the MIT License.
+ *
+ * Read LICENSE for the full license text.
+ */
+
+#ifndef HYPE_INI_FILE_HPP_
+#define HYPE_INI_FILE_HPP_
+
+#include "IniFile.h"
+
+#include <charconv>
+#include <cstddef>
+#include <cstdlib>
+#include <limits>
+#include <memory_resource>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace ini
+{
+	/**
+	 * @brief A key hashed ahead of time, at compile time for constants.
+	 *
+	 * static constexpr ini::Key port{"port"}; makes every lookup of "port"
+	 * skip measuring and hashing it.
+	 */
+	class Key
+	{
+	public:
+		constexpr Key(std::string_view name) noexcept
+			: key_{ name.data(), name.size(), hash(name) }
+		{
+		}
+
+		constexpr Key(const char* name) noexcept
+			: Key(std::string_view(name))
+		{
+		}
+
+		/**
+		 * @brief Same as __IniFile_HashSpan(), usable in constant expressions.
+		 */
+		static constexpr uint32_t hash(std::string_view name) noexcept
+		{
+			uint32_t val = 1;
+
+			for (char c : name)
+				val = static_cast<unsigned char>(c) + 179u * val;
+
+			return val;
+		}
+
+		constexpr std::string_view name() const noexcept
+		{
+			return std::string_view(key_.data, key_.length);
+		}
+
+		constexpr const IniKey* get() const noexcept { return &key_; }
+
+	private:
+		IniKey key_;
+	};
+
+	/**
+	 * @brief An IniAllocator that hands out memory from a memory_resource.
+	 *
+	 * The resource has to outlive every file read with it.
+	 */
+	inline IniAllocator makeAllocator(
+		std::pmr::memory_resource* resource) noexcept
+	{
+		IniAllocator allocator;
+
+		allocator.allocate = [](void* user, size_t size) noexcept -> void*
+		{
+			try
+			{
+				return static_cast<std::pmr::memory_resource*>(user)->allocate(
+					size, alignof(std::max_align_t));
+			}
+			catch (...)
+			{
+				return nullptr;
+			}
+		};
+
+		allocator.deallocate = [](void* user, void* pointer,
+			size_t size) noexcept
+		{
+			static_cast<std::pmr::memory_resource*>(user)->deallocate(pointer,
+				size, alignof(std::max_align_t));
+		};
+
+		allocator.user = resource;
+
+		return allocator;
+	}
+
+	namespace detail
+	{
+		template <typename T>
+		struct AlwaysFalse : std::false_type
+		{
+		};
+
+		inline IniOptions withResource(const IniOptions* options,
+			const IniAllocator* allocator) noexcept
+		{
+			IniOptions result;
+
+			if (options)
+				result = *options;
+			else
+				IniOptions_SetDefaults(&result);
+
+			result.allocator = allocator;
+
+			return result;
+		}
+
+		// text must be followed by a null terminator, which item values are.
+		template <typename T>
+		std::optional<T> convert(const char* text, size_t length) noexcept
+		{
+			if constexpr (std::is_same_v<T, std::string_view>)
+			{
+				return std::string_view(text, length);
+			}
+			else if constexpr (std::is_same_v<T, const char*>)
+			{
+				return text;
+			}
+			else if constexpr (std::is_same_v<T, bool>)
+			{
+				std::string_view value(text, length);
+
+				if (value == "true" || value == "yes" || value == "on" ||
+					value == "1")
+				{
+					return true;
+				}
+
+				if (value == "false" || value == "no" || value == "off" ||
+					value == "0")
+				{
+					return false;
+				}
+
+				return std::nullopt;
+			}
+			else if constexpr (std::is_integral_v<T>)
+			{
+				T result{};
+				const char* end = text + length;
+				auto parsed = std::from_chars(text, end, result);
+
+				if (parsed.ec != std::errc() || parsed.ptr != end)
+					return std::nullopt;
+
+				return result;
+			}
+			else if constexpr (std::is_floating_point_v<T>)
+			{
+				char* end = nullptr;
+				T result{};
+
+				if (!length)
+					return std::nullopt;
+
+				if constexpr (std::is_same_v<T, float>)
+					result = std::strtof(text, &end);
+				else if constexpr (std::is_same_v<T, double>)
+					result = std::strtod(text, &end);
+				else
+					result = std::strtold(text, &end);
+
+				if (end != text + length)
+					return std::nullopt;
+
+				return result;
+			}
+			else
+			{
+				static_assert(AlwaysFalse<T>::value,
+					"ini: no conversion for this type");
+			}
+		}
+	}
+
+	/**
+	 * @brief A borrowed item, valid as long as its File is not changed.
+	 */
+	class Item
+	{
+	public:
+		Item() noexcept = default;
+
+		Item(IniFile* file, IniItem* item) noexcept
+			: file_(file), item_(item)
+		{
+		}
+
+		explicit operator bool() const noexcept { return item_ != nullptr; }
+
+		std::string_view key() const noexcept
+		{
+			if (!item_)
+				return std::string_view();
+
+			return std::string_view(item_->key, item_->keyLength);
+		}
+
+		/**
+		 * @brief The value without copying, joined or decoded on first use.
+		 */
+		std::string_view value() const noexcept
+		{
+			const char* value = IniFile_GetItemValue(file_, item_);
+
+			if (!value)
+				return std::string_view();
+
+			return std::string_view(value, item_->valueLength);
+		}
+
+		/**
+		 * @brief The value converted to T, or nothing if it does not convert.
+		 *
+		 * T may be std::string_view, const char*, bool, any integer or
+		 * floating point type.
+		 */
+		template <typename T>
+		std::optional<T> as() const noexcept
+		{
+			const char* value = item_ ? IniFile_GetItemValue(file_, item_) :
+				nullptr;
+
+			if (!value)
+				return std::nullopt;
+
+			return detail::convert<T>(value, item_->valueLength);
+		}
+
+		IniItem* get() const noexcept { return item_; }
+
+	private:
+		IniFile* file_ = nullptr;
+		IniItem* item_ = nullptr;
+	};
+
+	/**
+	 * @brief A borrowed section, valid as long as its File is not changed.
+	 */
+	class Section
+	{
+	public:
+		class Iterator
+		{
+		public:
+			Iterator(IniFile* file, IniItem* item) noexcept
+				: file_(file), item_(item)
+			{
+			}
+
+			Item operator*() const noexcept { return Item(file_, item_); }
+
+			Iterator& operator++() noexcept
+			{
+				++item_;
+
+				return *this;
+			}
+
+			bool operator!=(const Iterator& other) const noexcept
+			{
+				return item_ != other.item_;
+			}
+
+		private:
+			IniFile* file_;
+			IniItem* item_;
+		};
+
+		Section() noexcept = default;
+
+		Section(IniFile* file, IniSection* section) noexcept
+			: file_(file), section_(section)
+		{
+		}
+
+		explicit operator bool() const noexcept { return section_ != nullptr; }
+
+		/**
+		 * @brief Name of the section, empty for the global items.
+		 */
+		std::string_view name() const noexcept
+		{
+			return section_ && section_->name ?
+				std::string_view(section_->name) : std::string_view();
+		}
+
+		size_t size() const noexcept { return IniSection_ItemCount(section_); }
+
+		Item at(size_t index) const noexcept
+		{
+			return Item(file_, IniSection_ItemAt(section_, index));
+		}
+
+		Item find(const Key& key) const noexcept
+		{
+			return Item(file_, IniSection_Find(section_, key.get()));
+		}
+
+		template <typename T>
+		std::optional<T> get(const Key& key) const noexcept
+		{
+			return find(key).template as<T>();
+		}
+
+		Iterator begin() const noexcept
+		{
+			return Iterator(file_, section_ ? section_->itemList : nullptr);
+		}
+
+		Iterator end() const noexcept
+		{
+			return Iterator(file_, section_ ?
+				section_->itemList + section_->itemCount : nullptr);
+		}
+
+		IniSection* get() const noexcept { return section_; }
+
+	private:
+		IniFile* file_ = nullptr;
+		IniSection* section_ = nullptr;
+	};
+
+	/**
+	 * @brief Owns an IniFile, freeing it when destroyed.
+	 *
+	 * Check it with operator bool after reading, IniFile_GetErrorHint() says
+	 * what went wrong.
+	 */
+	class File
+	{
+	public:
+		File() noexcept = default;
+
+		explicit File(IniFile* file) noexcept
+			: file_(file)
+		{
+		}
+
+		File(const File&) = delete;
+		File& operator=(const File&) = delete;
+
+		File(File&& other) noexcept
+			: file_(std::exchange(other.file_, nullptr))
+		{
+		}
+
+		File& operator=(File&& other) noexcept
+		{
+			if (this != &other)
+			{
+				IniFile_Free(file_);
+
+				file_ = std::exchange(other.file_, nullptr);
+			}
+
+			return *this;
+		}
+
+		~File() { IniFile_Free(file_); }
+
+		static File read(const char* filename,
+			const IniOptions* options = nullptr) noexcept
+		{
+			return File(IniFile_ReadFileWithOptions(filename, options));
+		}
+
+		/**
+		 * @brief Parses ini text in memory, which is copied.
+		 */
+		static File parse(std::string_view data,
+			const IniOptions* options = nullptr) noexcept
+		{
+			return File(IniFile_ReadBuffer(data.data(), data.size(), options));
+		}
+
+		/**
+		 * @brief Reads a file with all of its memory taken from resource.
+		 *
+		 * With a std::pmr::monotonic_buffer_resource the whole file can live
+		 * on the stack or in a per request arena.
+		 */
+		static File read(const char* filename,
+			std::pmr::memory_resource* resource,
+			const IniOptions* options = nullptr) noexcept
+		{
+			IniAllocator allocator = makeAllocator(resource);
+			IniOptions withResource = detail::withResource(options, &allocator);
+
+			return File(IniFile_ReadFileWithOptions(filename, &withResource));
+		}
+
+		/**
+		 * @brief Parses ini text with all memory taken from resource.
+		 */
+		static File parse(std::string_view data,
+			std::pmr::memory_resource* resource,
+			const IniOptions* options = nullptr) noexcept
+		{
+			IniAllocator allocator = makeAllocator(resource);
+			IniOptions withResource = detail::withResource(options, &allocator);
+
+			return File(IniFile_ReadBuffer(data.data(), data.size(),
+				&withResource));
+		}
+
+		explicit operator bool() const noexcept { return file_ != nullptr; }
+
+		Section global() const noexcept
+		{
+			return Section(file_, IniFile_FindSection(file_, nullptr, 0));
+		}
+
+		/**
+		 * @brief Finds a section, the global items for an empty name as in
+		 * StaticFile::find().
+		 */
+		Section section(std::string_view name) const noexcept
+		{
+			return Section(file_, IniFile_FindSection(file_,
+				name.empty() ? nullptr : name.data(), name.size()));
+		}
+
+		size_t sectionCount() const noexcept
+		{
+			return IniFile_SectionCount(file_);
+		}
+
+		Section sectionAt(size_t index) const noexcept
+		{
+			return Section(file_, IniFile_SectionAt(file_, index));
+		}
+
+		/**
+		 * @param section Name of the section, empty for the global items.
+		 */
+		Item find(std::string_view section, const Key& key) const noexcept
+		{
+			return this->section(section).find(key);
+		}
+
+		template <typename T>
+		std::optional<T> get(std::string_view section,
+			const Key& key) const noexcept
+		{
+			return find(section, key).template as<T>();
+		}
+
+		/**
+		 * @brief Sets an item, see IniFile_Set(). Borrowed items and sections
+		 * may be invalidated.
+		 */
+		bool set(const char* section, const char* key,
+			const char* value) noexcept
+		{
+			return IniFile_Set(file_, section, key, value) != nullptr;
+		}
+
+		IniFile* get() const noexcept { return file_; }
+
+		IniFile* release() noexcept { return std::exchange(file_, nullptr); }
+
+	private:
+		IniFile* file_ = nullptr;
+	};
+
+	/**
+	 * @brief Thrown by ini::parse() for text it can not read.
+	 *
+	 * When parsing in a constant expression this fails the build instead.
+	 */
+	class ParseError : public std::runtime_error
+	{
+	public:
+		ParseError(const char* message, size_t line)
+			: std::runtime_error(message), line_(line)
+		{
+		}
+
+		/**
+		 * @brief The line the problem was found on, counting from 1.
+		 */
+		size_t line() const noexcept { return line_; }
+
+	private:
+		size_t line_;
+	};
+
+	namespace detail
+	{
+		constexpr bool isSpace(char c) noexcept
+		{
+			return c == ' ' || c == '\t' || c == '\r' || c == '\v' ||
+				c == '\f';
+		}
+
+		constexpr std::string_view trim(std::string_view text) noexcept
+		{
+			while (!text.empty() && isSpace(text.front()))
+				text.remove_prefix(1);
+
+			while (!text.empty() && isSpace(text.back()))
+				text.remove_suffix(1);
+
+			return text;
+		}
+
+		/*
+		 * Walks text with the line rules of the default dialect, calling
+		 * onItem(section, content, line) for each line that is not blank, a
+		 * comment or a section declaration. A leading UTF-8 BOM is skipped.
+		 */
+		template <typename OnItem>
+		constexpr void scan(std::string_view text, OnItem&& onItem)
+		{
+			std::string_view section;
+			size_t line = 1;
+			size_t position = 0;
+
+			if (text.size() >= 3 && text[0] == '\xEF' && text[1] == '\xBB' &&
+				text[2] == '\xBF')
+			{
+				position = 3;
+			}
+
+			while (position < text.size())
+			{
+				size_t next = text.find('\n', position);
+				size_t end = next == std::string_view::npos ? text.size() : next;
+				std::string_view content = trim(
+					text.substr(position, end - position));
+
+				if (content.size() >= 2 && content[0] == DM_INI_COMMENT_3 &&
+					content[1] == DM_INI_COMMENT_4)
+				{
+					constexpr char terminator[] =
+						{ DM_INI_COMMENT_4, DM_INI_COMMENT_3, 0 };
+					size_t open = content.data() - text.data();
+					size_t close = text.find(terminator, open + 2);
+
+					if (close == std::string_view::npos)
+					{
+						throw ParseError(
+							DM_INI_ERROR_MESSAGE_UNTERMINATED_COMMENT, line);
+					}
+
+					for (size_t i = open; i < close; ++i)
+						line += text[i] == '\n';
+
+					// Whatever follows the comment on its last line still counts.
+					next = text.find('\n', close);
+					end = next == std::string_view::npos ? text.size() : next;
+					content = trim(text.substr(close + 2, end - close - 2));
+				}
+
+				if (content.empty() || content[0] == DM_INI_COMMENT_1 ||
+					content[0] == DM_INI_COMMENT_2 ||
+					(content.size() >= 2 && content[0] == DM_INI_COMMENT_3 &&
+					content[1] == DM_INI_COMMENT_3))
+				{
+					// Blank or commented out.
+				}
+				else if (content[0] == DM_LEFT_BRACKET)
+				{
+					size_t close = content.find(DM_RIGHT_BRACKET);
+
+					if (close == std::string_view::npos)
+						throw ParseError(DM_INI_ERROR_MESSAGE_BAD_SECTION, line);
+
+					section = trim(content.substr(1, close - 1));
+				}
+				else
+				{
+					onItem(section, content, line);
+				}
+
+				if (next == std::string_view::npos)
+					break;
+
+				position = next + 1;
+				++line;
+			}
+		}
+
+		// Counterpart of convert() for constant expressions. Values are not
+		// null terminated here, and there is no constexpr strtod.
+		template <typename T>
+		constexpr std::optional<T> convertConstant(
+			std::string_view value) noexcept
+		{
+			if constexpr (std::is_same_v<T, std::string_view>)
+			{
+				return value;
+			}
+			else if constexpr (std::is_same_v<T, bool>)
+			{
+				if (value == "true" || value == "yes" || value == "on" ||
+					value == "1")
+				{
+					return true;
+				}
+
+				if (value == "false" || value == "no" || value == "off" ||
+					value == "0")
+				{
+					return false;
+				}
+
+				return std::nullopt;
+			}
+			else if constexpr (std::is_integral_v<T>)
+			{
+				T result = 0;
+				bool negative = false;
+				size_t i = 0;
+
+				if constexpr (std::is_signed_v<T>)
+				{
+					if (!value.empty() && value[0] == '-')
+					{
+						negative = true;
+						i = 1;
+					}
+				}
+
+				if (i == value.size())
+					return std::nullopt;
+
+				for (; i < value.size(); ++i)
+				{
+					if (value[i] < '0' || value[i] > '9')
+						return std::nullopt;
+
+					T digit = static_cast<T>(value[i] - '0');
+
+					// Built towards the sign so the minimum still fits.
+					if (negative)
+					{
+						if (result < (std::numeric_limits<T>::min() + digit) / 10)
+							return std::nullopt;
+
+						result = static_cast<T>(result * 10 - digit);
+					}
+					else
+					{
+						if (result > (std::numeric_limits<T>::max() - digit) / 10)
+							return std::nullopt;
+
+						result = static_cast<T>(result * 10 + digit);
+					}
+				}
+
+				return result;
+			}
+			else
+			{
+				static_assert(AlwaysFalse<T>::value,
+					"ini: only std::string_view, bool and integers convert "
+					"at compile time");
+			}
+		}
+	}
+
+	/**
+	 * @brief Counts the items in text, which is the capacity a StaticFile
+	 * needs to hold them.
+	 *
+	 * @throws ParseError for malformed text, as StaticFile does.
+	 */
+	constexpr size_t itemCount(std::string_view text)
+	{
+		size_t count = 0;
+
+		detail::scan(text, [&count](std::string_view, std::string_view,
+			size_t)
+		{
+			++count;
+		});
+
+		return count;
+	}
+
+	/**
+	 * @brief An ini file parsed into a fixed size table, usually at compile
+	 * time by ini::parse().
+	 *
+	 * Keys and values are views of the parsed text, which has to outlive the
+	 * table. A string literal always does.
+	 */
+	template <size_t Capacity>
+	class StaticFile
+	{
+	public:
+		struct Entry
+		{
+			std::string_view section;
+			std::string_view key;
+			std::string_view value;
+			uint32_t hash = 0;
+		};
+
+		constexpr StaticFile() noexcept = default;
+
+		/**
+		 * @brief Parses text as IniFile_ReadBuffer() does with the default
+		 * IniOptions, which can not be changed here.
+		 *
+		 * So a BOM is skipped, block comments do not nest, UTF-8 is not
+		 * validated and the first of several equal keys is found. Values
+		 * continued over several lines and quoted values with escape
+		 * sequences would need memory of their own, so they are rejected
+		 * rather than read differently.
+		 *
+		 * @throws ParseError for malformed text, or more than Capacity items.
+		 */
+		constexpr explicit StaticFile(std::string_view text)
+		{
+			detail::scan(text, [this](std::string_view section,
+				std::string_view content, size_t line)
+			{
+				addItem(section, content, line);
+			});
+
+			sort();
+		}
+
+		constexpr size_t size() const noexcept { return count_; }
+
+		/**
+		 * @brief Looks up an item, the first one if a key is repeated.
+		 *
+		 * @param section Name of the section, empty for the global items.
+		 */
+		constexpr std::optional<std::string_view> find(
+			std::string_view section, const Key& key) const noexcept
+		{
+			uint32_t hash = key.get()->hash;
+			size_t low = 0;
+			size_t high = count_;
+
+			while (low < high)
+			{
+				size_t middle = low + (high - low) / 2;
+
+				if (entries_[middle].hash < hash)
+					low = middle + 1;
+				else
+					high = middle;
+			}
+
+			for (; low < count_ && entries_[low].hash == hash; ++low)
+			{
+				if (entries_[low].key == key.name() &&
+					entries_[low].section == section)
+				{
+					return entries_[low].value;
+				}
+			}
+
+			return std::nullopt;
+		}
+
+		/**
+		 * @brief The value converted to T, or nothing if it is missing or does
+		 * not convert.
+		 *
+		 * T may be std::string_view, bool or any integer type.
+		 */
+		template <typename T>
+		constexpr std::optional<T> get(std::string_view section,
+			const Key& key) const noexcept
+		{
+			std::optional<std::string_view> value = find(section, key);
+
+			if (!value)
+				return std::nullopt;
+
+			return detail::convertConstant<T>(*value);
+		}
+
+		constexpr const Entry* begin() const noexcept { return entries_; }
+		constexpr const Entry* end() const noexcept { return entries_ + count_; }
+
+	private:
+		constexpr void addItem(std::string_view section,
+			std::string_view content, size_t line)
+		{
+			size_t separator = content.find('=');
+
+			if (separator == std::string_view::npos)
+				throw ParseError(DM_INI_ERROR_MESSAGE_BAD_ITEM, line);
+
+			std::string_view key = detail::trim(content.substr(0, separator));
+			std::string_view value = detail::trim(
+				content.substr(separator + 1));
+
+			// Repeated "key[]" items are elements of the array "key".
+			if (key.size() >= 2 && key.substr(key.size() - 2) == "[]")
+				key.remove_suffix(2);
+
+			if (!value.empty() && value.back() == DM_INI_LINE_CONTINUATION)
+			{
+				throw ParseError("Continued values can not be parsed at "
+					"compile time", line);
+			}
+
+			if (!value.empty() && value[0] == DM_INI_QUOTE)
+			{
+				size_t close = value.find(DM_INI_QUOTE, 1);
+
+				if (close == std::string_view::npos)
+				{
+					throw ParseError(DM_INI_ERROR_MESSAGE_UNTERMINATED_QUOTE,
+						line);
+				}
+
+				// An escaped quote ends up here too, as "a\" is found first.
+				if (value.substr(1, close - 1).find(DM_INI_LINE_CONTINUATION) !=
+					std::string_view::npos)
+				{
+					throw ParseError("Escape sequences can not be decoded at "
+						"compile time", line);
+				}
+
+				// Only whitespace or a comment may follow the closing quote.
+				std::string_view rest = detail::trim(value.substr(close + 1));
+
+				if (!rest.empty() && rest[0] != DM_INI_COMMENT_1 &&
+					rest[0] != DM_INI_COMMENT_2)
+				{
+					throw ParseError(DM_INI_ERROR_MESSAGE_BAD_QUOTE, line);
+				}
+
+				value = value.substr(1, close - 1);
+			}
+
+			if (count_ == Capacity)
+				throw ParseError("More items than the table has room for", line);
+
+			entries_[count_].section = section;
+			entries_[count_].key = key;
+			entries_[count_].value = value;
+			entries_[count_].hash = Key::hash(key);
+			count_++;
+		}
+
+		// Stable, so the first of several equal keys is still found first.
+		// std::swap and std::sort are not constexpr before C++20.
+		constexpr void sort() noexcept
+		{
+			for (size_t i = 1; i < count_; ++i)
+			{
+				Entry entry = entries_[i];
+				size_t j = i;
+
+				for (; j > 0 && entries_[j - 1].hash > entry.hash; --j)
+					entries_[j] = entries_[j - 1];
+
+				entries_[j] = entry;
+			}
+		}
+
+		Entry entries_[Capacity > 0 ? Capacity : 1] = {};
+		size_t count_ = 0;
+	};
+
+	/**
+	 * @brief Parses text into a StaticFile with room for Capacity items.
+	 *
+	 * ini::itemCount() works out the exact capacity in the same constant
+	 * expression, so a malformed default config fails the build and lookups
+	 * fold to constants:
+	 *
+	 *     constexpr std::string_view text = R"(...)";
+	 *     constexpr auto cfg = ini::parse<ini::itemCount(text)>(text);
+	 *
+	 *     static_assert(*cfg.get<int>("server", "port") == 8080);
+	 */
+	template <size_t Capacity>
+	constexpr StaticFile<Capacity> parse(std::string_view text)
+	{
+		return StaticFile<Capacity>(text);
+	}
+
+	/**
+	 * @brief Parses a string literal into a StaticFile with room for every
+	 * item it could hold.
+	 *
+	 * constexpr auto cfg = ini::parse(R"(...)"); needs no name for the text.
+	 * The size comes from the length of the literal alone, so the table is
+	 * usually several times larger than needed. Use parse<Capacity>() with
+	 * ini::itemCount() where that matters.
+	 */
+	template <typename Char, size_t N>
+	constexpr StaticFile<N / 3 + 1> parse(const Char (&text)[N])
+	{
+		// Char is deduced so that parse<Capacity>("...") never picks this.
+		static_assert(std::is_same_v<Char, char>,
+			"ini: only char literals can be parsed");
+
+		// An item takes at least three bytes, as in "k=\n".
+		return StaticFile<N / 3 + 1>(std::string_view(text, N - 1));
+	}
+}
+
+#endif // HYPE_INI_FILE_HPP_
@@ -0,0 +1,56 @@
+/**
+ * Test.h - Assertions shared by the C and C++ tests.
+ *
+ * CIniFile: C implementation of reading ini configuration files.
+ * An open source project of HYPEWORKS.
+ *
+ * Copyright (C) 2017-2021 HYPEWORKS Ltd Co.
+ */
+
+/*
+ * This software library is open source and licensed under the MIT License.
+ *
+ * Read LICENSE for the full license text.
+ */
+
+#ifndef HYPE_INI_TEST_H_
+#define HYPE_INI_TEST_H_
+
+#include <stdio.h>
+#include <string.h>
+
+#if _DEBUG
+#if _MSC_VER
+#include <intrin.h>
+#define BREAKPOINT() __debugbreak()
+#else
+#include <signal.h>
+#define BREAKPOINT() raise(SIGINT);
+#endif
+#else
+#define BREAKPOINT() (void)0
+#endif
+
+#ifndef __FUNCSIG__
+#define __FUNCSIG__ __PRETTY_FUNCTION__
+#endif
+
+#define TEST_SUCCESS 0
+#define TEST_FAIL 1
+
+#define ASSERT() printf("Assertion failure in method %s on line %d\n", \
+	__FUNCSIG__, __LINE__); BREAKPOINT(); return TEST_FAIL;
+
+#define ASSERT_TRUE(x) if ((x) != true) { ASSERT() }
+#define ASSERT_FALSE(x) if ((x) != false) { ASSERT() }
+
+#define ASSERT_NULL(x) if (x) { ASSERT() }
+#define ASSERT_NOT_NULL(x) if (!(x)) { ASSERT() }
+
+#define ASSERT_EQUALS(x, y) if ((x) != (y)) { ASSERT() }
+#define ASSERT_NOT_EQUALS(x, y) if ((x) == (y)) { ASSERT() }
+
+#define ASSERT_STR_EQUALS(x, y) if (strcmp(x, y) != 0) { ASSERT() }
+#define ASSERT_STR_NOT_EQUALS(x, y) if (strcmp(x, y) == 0) { ASSERT() }
+
+#endif // HYPE_INI_TEST_H_
@@ -17,45 +17,13 @@
 #define TEST_CODE
 
 #include "IniFile.h"
+#include "Test.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 
-#if _DEBUG
-#if _MSC_VER
-#include <intrin.h>
-#define BREAKPOINT() __debugbreak()
-#else
-#include <signal.h>
-#define BREAKPOINT() raise(SIGINT);
-#endif
-#else
-#define BREAKPOINT() (void)0
-#endif
-
-#ifndef __FUNCSIG__
-#define __FUNCSIG__ __PRETTY_FUNCTION__
-#endif
-
-#define TEST_SUCCESS 0
-#define TEST_FAIL 1
-
-#define ASSERT() printf("Assertion failure in method %s on line %d\n", \
-	__FUNCSIG__, __LINE__); BREAKPOINT(); return TEST_FAIL;
-
-#define ASSERT_TRUE(x) if (x != true) { ASSERT() }
-#define ASSERT_FALSE(x) if (x != false) { ASSERT() }
-
-#define ASSERT_NULL(x) if (x) { ASSERT() }
-#define ASSERT_NOT_NULL(x) if (!x) { ASSERT() }
-
-#define ASSERT_EQUALS(x, y) if (x != y) { ASSERT() }
-#define ASSERT_NOT_EQUALS(x, y) if (x == y) { ASSERT() }
-
-#define ASSERT_STR_EQUALS(x, y) if (strcmp(x, y) != 0) { ASSERT() }
-#define ASSERT_STR_NOT_EQUALS(x, y) if (strcmp(x, y) == 0) { ASSERT() }
-
 typedef int(*TestFunction)();
 
 int TestErrorHint()
@@ -92,7 +60,14 @@ int TestFileRead()
 
 	IniFile* fileData = IniFile_ReadFile("test.ini");
 
-	ASSERT_NULL(fileData);
+	ASSERT_NOT_NULL(fileData);
+
+	ASSERT_STR_EQUALS(IniFile_GetValue(fileData, "section1", "test"), "foo");
+	ASSERT_STR_EQUALS(IniFile_GetValue(fileData, "section1", "test2"), "bar");
+	ASSERT_STR_EQUALS(IniFile_GetValue(fileData, "section2", "motd"),
+		"Welcome to the machine");
+	ASSERT_NULL(IniFile_GetValue(fileData, "section1", "motd"));
+	ASSERT_NULL(IniFile_GetSection(fileData, "section3"));
 
 	IniFile_Free(fileData);
 
@@ -154,6 +129,1571 @@ int TestComments()
 	return TEST_SUCCESS;
 }
 
+int TestLineClassifier()
+{
+	const char* blank1 = "   \t  \r\n";
+	const char* blank2 = "\r\n";
+	const char* indentedComment = "\t  ; indented";
+	const char* block = "  /* starts here";
+	const char* section = "  [section1]  \r\n";
+	const char* item = "key=value\r\n";
+	const char* continuation = "                    more value\n";
+	IniLineInfo info;
+
+	ASSERT_EQUALS(__IniFile_ClassifyLine(blank1, strlen(blank1), &info),
+		IniLine_Blank);
+	ASSERT_EQUALS(info.begin, info.end);
+
+	ASSERT_EQUALS(__IniFile_ClassifyLine(blank2, strlen(blank2), NULL),
+		IniLine_Blank);
+
+	ASSERT_EQUALS(__IniFile_ClassifyLine(indentedComment,
+		strlen(indentedComment), &info), IniLine_Comment);
+	ASSERT_EQUALS(info.begin, 3);
+
+	ASSERT_EQUALS(__IniFile_ClassifyLine(block, strlen(block), NULL),
+		IniLine_BlockComment);
+
+	ASSERT_EQUALS(__IniFile_ClassifyLine(section, strlen(section), &info),
+		IniLine_Section);
+	ASSERT_EQUALS(info.begin, 2);
+	ASSERT_EQUALS(info.end, 12);
+
+	ASSERT_EQUALS(__IniFile_ClassifyLine(item, strlen(item), &info),
+		IniLine_Item);
+	ASSERT_EQUALS(info.end, 9);
+
+	ASSERT_EQUALS(__IniFile_ClassifyLine(continuation, strlen(continuation),
+		&info), IniLine_Continuation);
+	ASSERT_EQUALS(info.begin, 20);
+
+	ASSERT_TRUE(__IniFile_IsLineCommented(blank1));
+	ASSERT_TRUE(__IniFile_IsLineCommented(indentedComment));
+
+	return TEST_SUCCESS;
+}
+
+int TestBlockCommentLexer()
+{
+	const char* opener = "/* disabled";
+	const char* body = "[not_a_section]";
+	const char* closer = "still disabled */ key=value";
+	const char* inline1 = "/* one */ /* two */ [section]";
+	const char* nested1 = "/* outer /* inner */";
+	const char* nested2 = "still outer */";
+	IniParser parser;
+	IniOptions options;
+	IniLineInfo info;
+
+	__IniParser_Initialize(&parser, NULL);
+
+	ASSERT_EQUALS(__IniParser_ClassifyLine(&parser, opener, strlen(opener),
+		&info), IniLine_Comment);
+	ASSERT_EQUALS(parser.commentDepth, 1);
+
+	ASSERT_EQUALS(__IniParser_ClassifyLine(&parser, body, strlen(body),
+		&info), IniLine_Comment);
+
+	ASSERT_EQUALS(__IniParser_ClassifyLine(&parser, closer, strlen(closer),
+		&info), IniLine_Item);
+	ASSERT_EQUALS(parser.commentDepth, 0);
+	ASSERT_EQUALS(info.begin, 18);
+	ASSERT_EQUALS(info.end, strlen(closer));
+
+	ASSERT_EQUALS(__IniParser_ClassifyLine(&parser, inline1, strlen(inline1),
+		&info), IniLine_Section);
+	ASSERT_EQUALS(info.begin, 20);
+
+	/* Without nesting the first terminator closes the comment. */
+	ASSERT_EQUALS(__IniParser_ClassifyLine(&parser, nested1, strlen(nested1),
+		&info), IniLine_Comment);
+	ASSERT_EQUALS(parser.commentDepth, 0);
+
+	IniOptions_SetDefaults(&options);
+	options.nestedComments = true;
+	__IniParser_Initialize(&parser, &options);
+
+	ASSERT_EQUALS(__IniParser_ClassifyLine(&parser, nested1, strlen(nested1),
+		&info), IniLine_Comment);
+	ASSERT_EQUALS(parser.commentDepth, 1);
+
+	ASSERT_EQUALS(__IniParser_ClassifyLine(&parser, nested2, strlen(nested2),
+		&info), IniLine_Comment);
+	ASSERT_EQUALS(parser.commentDepth, 0);
+
+	return TEST_SUCCESS;
+}
+
+typedef struct
+{
+	int sections;
+	int items;
+	char lastKey[64];
+} ParseCounts;
+
+bool CountSection(void* user, IniSpan name)
+{
+	(void)name;
+
+	((ParseCounts*)user)->sections++;
+
+	return true;
+}
+
+bool CountItem(void* user, IniSpan key, const IniValue* value)
+{
+	ParseCounts* counts = (ParseCounts*)user;
+	size_t length = key.length;
+
+	(void)value;
+
+	counts->items++;
+
+	if (length >= sizeof(counts->lastKey))
+		length = sizeof(counts->lastKey) - 1;
+
+	memcpy(counts->lastKey, key.data, length);
+	counts->lastKey[length] = '\0';
+
+	return true;
+}
+
+int TestBlockCommentSkip()
+{
+	const char* text = "a=1\n/*\n[hidden]\nb=2\n*/ c=3\n[shown]\nd=4\n";
+	const char* unterminated = "a=1\n/* never closed\n[hidden]\n";
+	IniHandler handler = { CountSection, CountItem };
+	ParseCounts counts;
+	char buffer[128];
+	size_t i;
+
+	memset(&counts, 0, sizeof(counts));
+
+	ASSERT_TRUE(IniFile_Parse(text, strlen(text), NULL, &handler, &counts));
+	ASSERT_EQUALS(counts.sections, 1);
+	ASSERT_EQUALS(counts.items, 3);
+	ASSERT_STR_EQUALS(counts.lastKey, "d");
+
+	ASSERT_FALSE(IniFile_Parse(unterminated, strlen(unterminated), NULL,
+		&handler, &counts));
+	ASSERT_NOT_NULL(IniFile_GetErrorHint());
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorCode,
+		DM_INI_ERROR_CODE_UNTERMINATED_COMMENT);
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorOffset, 4);
+
+	/* Put the terminator at every offset around the vector width. */
+	for (i = 0; i < 48; ++i)
+	{
+		memset(buffer, 0, sizeof(buffer));
+		memcpy(buffer, "/*\n", 3);
+		memset(buffer + 3, '*', i);
+		memcpy(buffer + 3 + i, "*/ key=value\n", 13);
+
+		memset(&counts, 0, sizeof(counts));
+
+		ASSERT_TRUE(IniFile_Parse(buffer, strlen(buffer), NULL, &handler,
+			&counts));
+		ASSERT_EQUALS(counts.items, 1);
+		ASSERT_STR_EQUALS(counts.lastKey, "key");
+	}
+
+	/* Keys longer than lastKey are cut short rather than overflowing it. */
+	memset(buffer, 'k', 100);
+	memcpy(buffer + 100, "=1\n", 4);
+
+	ASSERT_TRUE(IniFile_Parse(buffer, strlen(buffer), NULL, &handler,
+		&counts));
+	ASSERT_EQUALS(strlen(counts.lastKey), sizeof(counts.lastKey) - 1);
+
+	return TEST_SUCCESS;
+}
+
+int TestContinuation()
+{
+	const char* text =
+		"[certs]\n"
+		"pem = -----BEGIN-----\n"
+		"  AAAA\n"
+		"  BBBB\n"
+		"  -----END-----\n"
+		"list = a, \\\n"
+		"       b, \\\n"
+		"       c\n"
+		"next = plain\n";
+	IniOptions options;
+	IniFile* file = NULL;
+	IniItem* item = NULL;
+	IniSpan span;
+
+	IniOptions_SetDefaults(&options);
+	options.indentedContinuation = true;
+
+	file = IniFile_ReadBuffer(text, strlen(text), &options);
+
+	ASSERT_NOT_NULL(file);
+
+	/* Continued values stay as spans until asked for. */
+	item = IniFile_GetItem(file, "certs", "pem");
+
+	ASSERT_NOT_NULL(item);
+	ASSERT_NULL(item->value);
+	ASSERT_EQUALS(IniItem_GetSpanCount(item), 4);
+
+	span = IniItem_GetSpan(item, 2);
+
+	ASSERT_EQUALS(span.length, 4);
+	ASSERT_TRUE((memcmp(span.data, "BBBB", 4) == 0));
+
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, "certs", "pem"),
+		"-----BEGIN-----\nAAAA\nBBBB\n-----END-----");
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, "certs", "list"), "a, b, c");
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, "certs", "next"), "plain");
+
+	item = IniFile_GetItem(file, "certs", "next");
+
+	ASSERT_EQUALS(IniItem_GetSpanCount(item), 1);
+
+	IniFile_Free(file);
+
+	/* Without the option the indented lines are bare keys, not values. */
+	file = IniFile_ReadBuffer(text, strlen(text), NULL);
+
+	ASSERT_NULL(file);
+
+	return TEST_SUCCESS;
+}
+
+int TestQuotedValues()
+{
+	const char* text =
+		"plain = \"  padded  \"\n"
+		"escaped = \"tab\\there\\n\\\"q\\\" \\u00e9 \\ud83d\\ude00\" ; note\n"
+		"empty = \"\"\n";
+	const char* unterminated = "key = \"never closed\n";
+	const char* trailing = "key = \"closed\" junk\n";
+	IniFile* file = NULL;
+	IniItem* item = NULL;
+	const char* value = NULL;
+
+	file = IniFile_ReadBuffer(text, strlen(text), NULL);
+
+	ASSERT_NOT_NULL(file);
+
+	/* Without escapes the value comes straight from the buffer. */
+	item = IniFile_GetItem(file, NULL, "plain");
+
+	ASSERT_NOT_NULL(item);
+	ASSERT_TRUE((item->value > file->buffer &&
+		item->value < file->buffer + file->bufferLength));
+	ASSERT_STR_EQUALS(item->value, "  padded  ");
+
+	/* Escapes are only decoded once somebody asks. */
+	item = IniFile_GetItem(file, NULL, "escaped");
+
+	ASSERT_NOT_NULL(item);
+	ASSERT_NULL(item->value);
+
+	value = IniFile_GetValue(file, NULL, "escaped");
+
+	ASSERT_STR_EQUALS(value, "tab\there\n\"q\" \xC3\xA9 \xF0\x9F\x98\x80");
+	ASSERT_EQUALS(value, IniFile_GetValue(file, NULL, "escaped"));
+
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, NULL, "empty"), "");
+
+	IniFile_Free(file);
+
+	ASSERT_NULL(IniFile_ReadBuffer(unterminated, strlen(unterminated), NULL));
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorCode,
+		DM_INI_ERROR_CODE_UNTERMINATED_QUOTE);
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorOffset, 6);
+
+	ASSERT_NULL(IniFile_ReadBuffer(trailing, strlen(trailing), NULL));
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorCode,
+		DM_INI_ERROR_CODE_BAD_QUOTE);
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorOffset, 15);
+
+	return TEST_SUCCESS;
+}
+
+int TestArrays()
+{
+	const char* text =
+		"[allow]\n"
+		"host[] = alpha\n"
+		"other = x\n"
+		"host[] = \"be\\ta\"\n"
+		"host[] = gamma\n"
+		"list = one, two ,three,,  four-is-a-longer-element , five\n"
+		"quoted = \"a, b\"\n"
+		"empty =\n";
+	const IniSpan* elements = NULL;
+	size_t count = 0;
+	const IniSpan* again = NULL;
+	IniFile* file = NULL;
+
+	file = IniFile_ReadBuffer(text, strlen(text), NULL);
+
+	ASSERT_NOT_NULL(file);
+
+	ASSERT_TRUE(IniFile_GetArray(file, "allow", "host", &elements, &count));
+	ASSERT_EQUALS(count, 3);
+	ASSERT_TRUE((elements[1].length == 4 &&
+		memcmp(elements[1].data, "be\ta", 4) == 0));
+	ASSERT_TRUE((elements[2].length == 5 &&
+		memcmp(elements[2].data, "gamma", 5) == 0));
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, "allow", "host"), "alpha");
+
+	ASSERT_TRUE(IniFile_GetArray(file, "allow", "list", &elements, &count));
+	ASSERT_EQUALS(count, 6);
+	ASSERT_TRUE((elements[1].length == 3 &&
+		memcmp(elements[1].data, "two", 3) == 0));
+	ASSERT_EQUALS(elements[3].length, 0);
+	ASSERT_TRUE((elements[4].length == 24 &&
+		memcmp(elements[4].data, "four-is-a-longer-element", 24) == 0));
+	ASSERT_TRUE((elements[5].length == 4 &&
+		memcmp(elements[5].data, "five", 4) == 0));
+
+	/* The split is cached. */
+	ASSERT_TRUE(IniFile_GetArray(file, "allow", "list", &again, &count));
+	ASSERT_EQUALS(again, elements);
+
+	ASSERT_TRUE(IniFile_GetArray(file, "allow", "quoted", &elements, &count));
+	ASSERT_EQUALS(count, 1);
+
+	ASSERT_TRUE(IniFile_GetArray(file, "allow", "empty", &elements, &count));
+	ASSERT_EQUALS(count, 0);
+
+	ASSERT_FALSE(IniFile_GetArray(file, "allow", "missing", &elements, &count));
+
+	IniFile_Free(file);
+
+	return TEST_SUCCESS;
+}
+
+typedef struct
+{
+	int count;
+	char names[256];
+} VisitedSections;
+
+bool VisitSection(void* user, IniSection* section)
+{
+	VisitedSections* visited = (VisitedSections*)user;
+
+	visited->count++;
+
+	strcat(visited->names, section->name);
+	strcat(visited->names, " ");
+
+	return true;
+}
+
+int TestSectionTree()
+{
+	const char* text =
+		"top = 1\n"
+		"[db]\n"
+		"name = main\n"
+		"[db.primary.pool]\n"
+		"size = 8\n"
+		"[db.replica]\n"
+		"host = r1\n"
+		"[dbx]\n"
+		"x = 1\n"
+		"[db.primary]\n"
+		"pool.size = 16\n"
+		"host = p1\n"
+		"[db.primary.pool.size]\n"
+		"unit = conns\n";
+	IniFile* file = NULL;
+	IniItem* item = NULL;
+	VisitedSections visited;
+
+	file = IniFile_ReadBuffer(text, strlen(text), NULL);
+
+	ASSERT_NOT_NULL(file);
+
+	memset(&visited, 0, sizeof(visited));
+	ASSERT_TRUE(IniFile_ForEachUnder(file, "db", VisitSection, &visited));
+	ASSERT_STR_EQUALS(visited.names,
+		"db db.primary db.primary.pool db.primary.pool.size db.replica ");
+
+	memset(&visited, 0, sizeof(visited));
+	ASSERT_TRUE(IniFile_ForEachUnder(file, "db.", VisitSection, &visited));
+	ASSERT_EQUALS(visited.count, 4);
+
+	memset(&visited, 0, sizeof(visited));
+	ASSERT_TRUE(IniFile_ForEachUnder(file, "db.nothing", VisitSection,
+		&visited));
+	ASSERT_EQUALS(visited.count, 0);
+
+	memset(&visited, 0, sizeof(visited));
+	ASSERT_TRUE(IniFile_ForEachUnder(file, "", VisitSection, &visited));
+	ASSERT_EQUALS(visited.count, 6);
+
+	item = IniFile_GetPath(file, "db.primary.pool.size");
+
+	ASSERT_NOT_NULL(item);
+	ASSERT_STR_EQUALS(item->value, "8");
+
+	/* Falls back to a shorter section when the deeper one lacks the key. */
+	item = IniFile_GetPath(file, "db.primary.host");
+
+	ASSERT_NOT_NULL(item);
+	ASSERT_STR_EQUALS(item->value, "p1");
+
+	item = IniFile_GetPath(file, "db.primary.pool.size.unit");
+
+	ASSERT_NOT_NULL(item);
+	ASSERT_STR_EQUALS(item->value, "conns");
+
+	item = IniFile_GetPath(file, "top");
+
+	ASSERT_NOT_NULL(item);
+	ASSERT_STR_EQUALS(item->value, "1");
+
+	ASSERT_NULL(IniFile_GetPath(file, "db.primary.missing"));
+	ASSERT_NULL(IniFile_GetPath(file, "db"));
+
+	IniFile_Free(file);
+
+	return TEST_SUCCESS;
+}
+
+typedef struct
+{
+	char keys[128];
+} VisitedKeys;
+
+bool VisitKey(void* user, IniItem* item)
+{
+	VisitedKeys* visited = (VisitedKeys*)user;
+
+	strcat(visited->keys, item->key);
+	strcat(visited->keys, " ");
+
+	return true;
+}
+
+int TestSortedOrder()
+{
+	const char* text =
+		"zeta = last\n"
+		"[b]\n"
+		"delta = 4\n"
+		"alpha = 1\n"
+		"charlie = 3\n"
+		"bravo = 2\n"
+		"list[] = x\n"
+		"list[] = \" y\"\n"
+		"[a]\n"
+		"key = a\\\n"
+		"  b\n";
+	const char* expected =
+		"zeta=last\n"
+		"\n"
+		"[a]\n"
+		"key=ab\n"
+		"\n"
+		"[b]\n"
+		"alpha=1\n"
+		"bravo=2\n"
+		"charlie=3\n"
+		"delta=4\n"
+		"list[]=x\n"
+		"list[]=\" y\"\n";
+	IniFile* file = NULL;
+	IniSection* section = NULL;
+	VisitedKeys visited;
+	FILE* fp = NULL;
+	char written[256];
+	size_t length = 0;
+
+	file = IniFile_ReadBuffer(text, strlen(text), NULL);
+
+	ASSERT_NOT_NULL(file);
+
+	section = IniFile_GetSection(file, "b");
+
+	ASSERT_NOT_NULL(section);
+
+	memset(&visited, 0, sizeof(visited));
+	ASSERT_TRUE(IniSection_ForEachSorted(section, VisitKey, &visited));
+	ASSERT_STR_EQUALS(visited.keys, "alpha bravo charlie delta list ");
+
+	memset(&visited, 0, sizeof(visited));
+	ASSERT_TRUE(IniSection_Range(section, "b", "d", VisitKey, &visited));
+	ASSERT_STR_EQUALS(visited.keys, "bravo charlie ");
+
+	memset(&visited, 0, sizeof(visited));
+	ASSERT_TRUE(IniSection_Range(section, "charlie", NULL, VisitKey,
+		&visited));
+	ASSERT_STR_EQUALS(visited.keys, "charlie delta list ");
+
+	fp = tmpfile();
+
+	ASSERT_NOT_NULL(fp);
+	ASSERT_TRUE(IniFile_Write(file, fp, DM_INI_WRITE_SORTED));
+
+	rewind(fp);
+	length = fread(written, 1, sizeof(written) - 1, fp);
+	written[length] = '\0';
+	fclose(fp);
+
+	ASSERT_STR_EQUALS(written, expected);
+
+	IniFile_Free(file);
+
+	/* What was written reads back the same. */
+	file = IniFile_ReadBuffer(written, length, NULL);
+
+	ASSERT_NOT_NULL(file);
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, "a", "key"), "ab");
+
+	IniFile_Free(file);
+
+	return TEST_SUCCESS;
+}
+
+int TestEditing()
+{
+	const char* text =
+		"name = old\n"
+		"[server]\n"
+		"host = localhost\n"
+		"port = 8080\n"
+		"tags[] = a\n"
+		"[client]\n"
+		"retries = 3\n";
+	IniFile* file = NULL;
+	IniSection* section = NULL;
+	char key[16];
+	int i = 0;
+
+	file = IniFile_ReadBuffer(text, strlen(text), NULL);
+
+	ASSERT_NOT_NULL(file);
+
+	/* Shorter values are written over the old ones, longer ones copied. */
+	ASSERT_NOT_NULL(IniFile_Set(file, NULL, "name", "new"));
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, NULL, "name"), "new");
+	ASSERT_NOT_NULL(IniFile_Set(file, "server", "host", "example.com"));
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, "server", "host"), "example.com");
+	ASSERT_NOT_NULL(IniFile_Set(file, "server", "tags", "b"));
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, "server", "tags"), "b");
+
+	/* New items and sections. */
+	ASSERT_NOT_NULL(IniFile_Set(file, "server", "timeout", "30"));
+	ASSERT_NOT_NULL(IniFile_Set(file, "logging", "level", "debug"));
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, "logging", "level"), "debug");
+	ASSERT_EQUALS(file->sectionCount, 3);
+
+	ASSERT_TRUE(IniFile_Remove(file, "server", "host"));
+	ASSERT_FALSE(IniFile_Remove(file, "server", "host"));
+	ASSERT_NULL(IniFile_GetValue(file, "server", "host"));
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, "server", "port"), "8080");
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, "server", "timeout"), "30");
+
+	section = IniFile_GetSection(file, "server");
+
+	ASSERT_NOT_NULL(section);
+	ASSERT_EQUALS(section->itemCount, 3);
+
+	/* Churn enough to rebuild the index around tombstones. */
+	for (i = 0; i < 200; ++i)
+	{
+		sprintf(key, "k%d", i);
+
+		ASSERT_NOT_NULL(IniFile_Set(file, "server", key, "v"));
+
+		if (i % 3)
+		{
+			ASSERT_TRUE(IniFile_Remove(file, "server", key));
+		}
+	}
+
+	for (i = 0; i < 200; ++i)
+	{
+		sprintf(key, "k%d", i);
+
+		if (i % 3)
+		{
+			ASSERT_NULL(IniFile_GetItem(file, "server", key));
+		}
+		else
+		{
+			ASSERT_NOT_NULL(IniFile_GetItem(file, "server", key));
+		}
+	}
+
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, "server", "port"), "8080");
+
+	ASSERT_TRUE(IniFile_RemoveSection(file, "server"));
+	ASSERT_FALSE(IniFile_RemoveSection(file, "server"));
+	ASSERT_FALSE(IniFile_RemoveSection(file, NULL));
+	ASSERT_NULL(IniFile_GetSection(file, "server"));
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, "client", "retries"), "3");
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, "logging", "level"), "debug");
+	ASSERT_EQUALS(file->sectionCount, 2);
+
+	section = IniFile_AddSection(file, "empty");
+
+	ASSERT_NOT_NULL(section);
+	ASSERT_TRUE((section == IniFile_AddSection(file, "empty")));
+	ASSERT_EQUALS(section->itemCount, 0);
+
+	IniFile_Free(file);
+
+	return TEST_SUCCESS;
+}
+
+int TestCounts()
+{
+	const char* text =
+		"g = 1\n"
+		"[one]\n"
+		"a = 1\n"
+		"b = 2\n"
+		"[two]\n"
+		"c = 3\n";
+	IniFile* file = NULL;
+	IniSection* section = NULL;
+	size_t items = 0;
+	size_t i = 0;
+	size_t j = 0;
+
+	file = IniFile_ReadBuffer(text, strlen(text), NULL);
+
+	ASSERT_NOT_NULL(file);
+	ASSERT_EQUALS(IniFile_SectionCount(file), 2);
+	ASSERT_EQUALS(IniSection_ItemCount(IniFile_GetSection(file, NULL)), 1);
+	ASSERT_NULL(IniFile_SectionAt(file, 2));
+	ASSERT_EQUALS(IniFile_SectionCount(NULL), 0);
+	ASSERT_EQUALS(IniSection_ItemCount(NULL), 0);
+
+	for (i = 0; i < IniFile_SectionCount(file); ++i)
+	{
+		section = IniFile_SectionAt(file, i);
+
+		ASSERT_NOT_NULL(section);
+
+		for (j = 0; j < IniSection_ItemCount(section); ++j)
+		{
+			ASSERT_NOT_NULL(IniSection_ItemAt(section, j));
+			items++;
+		}
+
+		ASSERT_NULL(IniSection_ItemAt(section, j));
+	}
+
+	ASSERT_EQUALS(items, 3);
+	ASSERT_STR_EQUALS(IniSection_ItemAt(IniFile_SectionAt(file, 0), 1)->key,
+		"b");
+
+	IniFile_Free(file);
+
+	return TEST_SUCCESS;
+}
+
+int TestKeys()
+{
+	const char* text =
+		"[server.primary]\n"
+		"port = 8080\n"
+		"banner = \"hi\\tthere\"\n";
+	IniFile* file = NULL;
+	IniSection* section = NULL;
+	IniKey port = IniKey_Make("port", 4);
+	IniKey banner = IniKey_Make("banner!", 6);
+
+	file = IniFile_ReadBuffer(text, strlen(text), NULL);
+
+	ASSERT_NOT_NULL(file);
+	ASSERT_EQUALS(port.hash, __IniFile_HashSpan("port", 4));
+
+	/* Names do not need to be null terminated. */
+	section = IniFile_FindSection(file, "server.primary.pool", 14);
+
+	ASSERT_NOT_NULL(section);
+	ASSERT_NULL(IniFile_FindSection(file, "server", 6));
+	ASSERT_TRUE((IniFile_FindSection(file, NULL, 0) == &file->globalSection));
+
+	ASSERT_STR_EQUALS(IniFile_GetItemValue(file,
+		IniSection_Find(section, &port)), "8080");
+	ASSERT_STR_EQUALS(IniFile_GetItemValue(file,
+		IniSection_Find(section, &banner)), "hi\tthere");
+	ASSERT_NULL(IniFile_GetItemValue(file, NULL));
+
+	IniFile_Free(file);
+
+	return TEST_SUCCESS;
+}
+
+typedef struct
+{
+	size_t allocations;
+	size_t liveBytes;
+
+	/* Allocations left before failing, or -1 to never fail. */
+	long budget;
+} CountingAllocator;
+
+void* CountingAllocate(void* user, size_t size)
+{
+	CountingAllocator* counting = (CountingAllocator*)user;
+
+	if (counting->budget == 0)
+		return NULL;
+
+	if (counting->budget > 0)
+		counting->budget--;
+
+	counting->allocations++;
+	counting->liveBytes += size;
+
+	return malloc(size);
+}
+
+void CountingDeallocate(void* user, void* pointer, size_t size)
+{
+	CountingAllocator* counting = (CountingAllocator*)user;
+
+	counting->liveBytes -= size;
+
+	free(pointer);
+}
+
+int TestAllocator()
+{
+	const char* text =
+		"g = 1\n"
+		"[one]\n"
+		"a = first \\\n"
+		"  second\n"
+		"list[] = x\n"
+		"list[] = y\n"
+		"[one.two]\n"
+		"b = \"q\\tq\"\n";
+	CountingAllocator counting;
+	VisitedKeys visited;
+	IniAllocator allocator;
+	IniOptions options;
+	IniFile* file = NULL;
+	long budget = 0;
+
+	memset(&counting, 0, sizeof(counting));
+	counting.budget = -1;
+
+	allocator.allocate = CountingAllocate;
+	allocator.deallocate = CountingDeallocate;
+	allocator.user = &counting;
+
+	IniOptions_SetDefaults(&options);
+	options.allocator = &allocator;
+
+	file = IniFile_ReadBuffer(text, strlen(text), &options);
+
+	ASSERT_NOT_NULL(file);
+	ASSERT_TRUE((counting.allocations > 0));
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, "one", "a"), "first second");
+	ASSERT_NOT_NULL(IniFile_Set(file, "three", "c", "3"));
+	ASSERT_NOT_NULL(IniFile_GetPath(file, "one.two.b"));
+	memset(&visited, 0, sizeof(visited));
+	ASSERT_TRUE(IniSection_ForEachSorted(IniFile_GetSection(file, "one"),
+		VisitKey, &visited));
+	ASSERT_STR_EQUALS(visited.keys, "a list ");
+
+	IniFile_Free(file);
+
+	ASSERT_EQUALS(counting.liveBytes, 0);
+
+	/* Fail each allocation in turn, nothing may be left behind. */
+	for (budget = 0; budget < 64; ++budget)
+	{
+		counting.budget = budget;
+
+		file = IniFile_ReadBuffer(text, strlen(text), &options);
+
+		if (file)
+		{
+			IniFile_GetValue(file, "one", "b");
+			IniFile_GetPath(file, "one.two.b");
+			IniFile_Free(file);
+		}
+
+		ASSERT_EQUALS(counting.liveBytes, 0);
+	}
+
+	return TEST_SUCCESS;
+}
+
+int TestImage()
+{
+	const char* text =
+		"top = level\n"
+		"[server]\n"
+		"host = \"local\\thost\"\n"
+		"port = 8080\n"
+		"port = 9090\n"
+		"list[] = a\n"
+		"list[] = b\n"
+		"[client]\n"
+		"host = remote\n";
+	IniFile* file = NULL;
+	IniImage* image = NULL;
+	const IniImageItem* item = NULL;
+	FILE* fp = NULL;
+	char written[16384];
+	size_t length = 0;
+	char key[16];
+	int i = 0;
+
+	file = IniFile_ReadBuffer(text, strlen(text), NULL);
+
+	ASSERT_NOT_NULL(file);
+
+	/* Enough keys that most buckets hold several. */
+	for (i = 0; i < 100; ++i)
+	{
+		sprintf(key, "k%d", i);
+
+		ASSERT_NOT_NULL(IniFile_Set(file, "client", key, key));
+	}
+
+	image = IniImage_Build(file);
+
+	ASSERT_NOT_NULL(image);
+	ASSERT_EQUALS(image->sectionCount, 3);
+	ASSERT_EQUALS(image->itemCount, 105);
+
+	ASSERT_STR_EQUALS(IniImage_GetValue(image, NULL, "top"), "level");
+	ASSERT_STR_EQUALS(IniImage_GetValue(image, "server", "host"),
+		"local\thost");
+	ASSERT_STR_EQUALS(IniImage_GetValue(image, "client", "host"), "remote");
+	ASSERT_STR_EQUALS(IniImage_GetValue(image, "server", "port"),
+		IniFile_GetValue(file, "server", "port"));
+	ASSERT_NULL(IniImage_GetValue(image, "server", "missing"));
+	ASSERT_NULL(IniImage_GetValue(image, "missing", "host"));
+	ASSERT_NULL(IniImage_GetValue(image, NULL, "host"));
+
+	for (i = 0; i < 100; ++i)
+	{
+		sprintf(key, "k%d", i);
+
+		ASSERT_STR_EQUALS(IniImage_GetValue(image, "client", key), key);
+	}
+
+	item = IniImage_Find(image, "server", "list");
+
+	ASSERT_NOT_NULL(item);
+	ASSERT_EQUALS(item->elementCount, 2);
+	ASSERT_TRUE((strncmp(item->elements[1].data, "b", 1) == 0));
+
+	fp = tmpfile();
+
+	ASSERT_NOT_NULL(fp);
+	ASSERT_TRUE(IniImage_Write(image, fp, "config"));
+
+	rewind(fp);
+	length = fread(written, 1, sizeof(written) - 1, fp);
+	written[length] = '\0';
+	fclose(fp);
+
+	ASSERT_NOT_NULL(strstr(written, "const IniImage config =\n"));
+	ASSERT_NOT_NULL(strstr(written,
+		"\t{ \"host\", 4, \"local\\011host\", 10, 1, NULL, 0 },\n"));
+	ASSERT_NOT_NULL(strstr(written, "config_elements + 0, 2 }"));
+
+	IniImage_Free(image);
+	IniFile_Free(file);
+
+	return TEST_SUCCESS;
+}
+
+int TestValueConversion()
+{
+	const char* source = "80\\\n80";
+	IniSpan spans[2] = { { source, 2 }, { source + 4, 2 } };
+	IniValue value = { spans, 1, 0 };
+	long number = 0;
+	double real = 0;
+	bool flag = false;
+	char text[5];
+
+	ASSERT_TRUE(IniValue_ToLong(&value, &number));
+	ASSERT_EQUALS(number, 80);
+
+	/* Lines continued with a backslash are joined before converting. */
+	value.spanCount = 2;
+
+	ASSERT_TRUE(IniValue_ToLong(&value, &number));
+	ASSERT_EQUALS(number, 8080);
+	ASSERT_TRUE(IniValue_ToDouble(&value, &real));
+	ASSERT_TRUE((real == 8080.0));
+	ASSERT_TRUE(IniValue_ToString(&value, text, sizeof(text)));
+	ASSERT_STR_EQUALS(text, "8080");
+	ASSERT_FALSE(IniValue_ToString(&value, text, 4));
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorCode, DM_INI_ERROR_CODE_BAD_VALUE);
+	ASSERT_FALSE(IniValue_ToBool(&value, &flag));
+
+	spans[0].data = "yes";
+	spans[0].length = 3;
+	value.spanCount = 1;
+
+	ASSERT_TRUE(IniValue_ToBool(&value, &flag));
+	ASSERT_TRUE(flag);
+	ASSERT_FALSE(IniValue_ToLong(&value, &number));
+	ASSERT_EQUALS(number, 8080);
+
+	spans[0].data = "off";
+
+	ASSERT_TRUE(IniValue_ToBool(&value, &flag));
+	ASSERT_FALSE(flag);
+
+	return TEST_SUCCESS;
+}
+
+int TestSectionText()
+{
+	const char* text =
+		"top = 1\n"
+		"[a]\n"
+		"x = 1\n"
+		"v = foo\\\n"
+		"[a]\n"
+		"/* [b]\n"
+		"*/ [b]\n"
+		"k = 2\n"
+		"[a]\n"
+		"y = 3\n";
+	size_t length = strlen(text);
+	IniSpan span;
+	const char* rest = NULL;
+
+	ASSERT_TRUE(IniFile_FindSectionText(text, length, NULL, 0, NULL, &span));
+	ASSERT_TRUE((span.data == text));
+	ASSERT_EQUALS(span.length, 8);
+
+	/* The "[a]" after a backslash is part of the value of v. */
+	ASSERT_TRUE(IniFile_FindSectionText(text, length, "a", 1, NULL, &span));
+	ASSERT_EQUALS(span.length, 28);
+	ASSERT_TRUE((strncmp(span.data, "x = 1\nv = foo\\\n[a]\n", 19) == 0));
+
+	/* The "[b]" in the comment is skipped, the one after it is found. */
+	ASSERT_TRUE(IniFile_FindSectionText(text, length, "b", 1, NULL, &span));
+	ASSERT_EQUALS(span.length, 6);
+	ASSERT_TRUE((strncmp(span.data, "k = 2\n", 6) == 0));
+
+	rest = span.data + span.length;
+
+	ASSERT_TRUE(IniFile_FindSectionText(rest, length - (size_t)(rest - text),
+		"a", 1, NULL, &span));
+	ASSERT_EQUALS(span.length, 6);
+	ASSERT_TRUE((strncmp(span.data, "y = 3\n", 6) == 0));
+
+	ASSERT_FALSE(IniFile_FindSectionText(text, length, "c", 1, NULL, &span));
+	ASSERT_NULL(IniFile_GetErrorHint());
+
+	ASSERT_FALSE(IniFile_FindSectionText("/* open\n[c]\n", 12, "c", 1, NULL,
+		&span));
+	ASSERT_NOT_NULL(IniFile_GetErrorHint());
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorCode,
+		DM_INI_ERROR_CODE_UNTERMINATED_COMMENT);
+
+	return TEST_SUCCESS;
+}
+
+int TestJson()
+{
+	const char* text =
+		"top = 1\n"
+		"quoted = \"tab\\there\"\n"
+		"[server]\n"
+		"list[] = a\n"
+		"list[] = b\n"
+		"name = say \"hi\" to everyone in the room\n"
+		"[empty]\n";
+	IniDialect dialect;
+	IniOptions options;
+	FILE* fp = NULL;
+	char written[1024];
+	size_t length = 0;
+
+	fp = tmpfile();
+
+	ASSERT_NOT_NULL(fp);
+	ASSERT_TRUE(IniFile_ParseToJson(text, strlen(text), NULL, 0, fp));
+
+	rewind(fp);
+	length = fread(written, 1, sizeof(written) - 1, fp);
+	written[length] = '\0';
+	fclose(fp);
+
+	ASSERT_STR_EQUALS(written, "{\"top\":\"1\",\"quoted\":\"tab\\there\","
+		"\"server\":{\"list\":[\"a\",\"b\"],"
+		"\"name\":\"say \\\"hi\\\" to everyone in the room\"},"
+		"\"empty\":{}}\n");
+
+	fp = tmpfile();
+
+	ASSERT_NOT_NULL(fp);
+	ASSERT_TRUE(IniFile_ParseToJson(text, strlen(text), NULL,
+		DM_INI_JSON_LINES, fp));
+
+	rewind(fp);
+	length = fread(written, 1, sizeof(written) - 1, fp);
+	written[length] = '\0';
+	fclose(fp);
+
+	ASSERT_NOT_NULL(strstr(written,
+		"{\"section\":null,\"key\":\"top\",\"value\":\"1\"}\n"));
+	ASSERT_NOT_NULL(strstr(written,
+		"{\"section\":\"server\",\"key\":\"list\",\"value\":\"b\"}\n"));
+
+	/* A bare "[]" key is the array with an empty name, as in the builder. */
+	IniDialect_SetDefaults(&dialect);
+	dialect.sectionOpen = '<';
+	dialect.sectionClose = '>';
+
+	ASSERT_TRUE(IniDialect_Compile(&dialect));
+
+	IniOptions_SetDefaults(&options);
+	options.dialect = &dialect;
+
+	fp = tmpfile();
+
+	ASSERT_NOT_NULL(fp);
+	ASSERT_TRUE(IniFile_ParseToJson("[] = a\n[] = b\n", 14, &options, 0, fp));
+
+	rewind(fp);
+	length = fread(written, 1, sizeof(written) - 1, fp);
+	written[length] = '\0';
+	fclose(fp);
+
+	ASSERT_STR_EQUALS(written, "{\"\":[\"a\",\"b\"]}\n");
+
+	fp = tmpfile();
+
+	ASSERT_NOT_NULL(fp);
+	ASSERT_FALSE(IniFile_ParseToJson("[broken\n", 8, NULL, 0, fp));
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorCode,
+		DM_INI_ERROR_CODE_BAD_SECTION);
+
+	fclose(fp);
+
+	return TEST_SUCCESS;
+}
+
+int TestUtf8()
+{
+	const char* bom = "\xEF\xBB\xBFname = caf\xC3\xA9\n";
+	const char* overlong = "a = 1\nb = \xC0\xAF\n";
+	const char* surrogate = "[s]\n/* \xED\xA0\x80 */\n";
+	const char* truncated = "text = abcdefghijklmnopqrstuvwxyz \xE2\x82";
+	const char* longLine = "name = a value well past sixteen bytes \xC3\xA9 \xC3\n";
+	const char* longComment = "/* a long comment\nthat goes on \xFF and on */\n";
+	const char* afterComment = "/* one\ntwo */ k\xFF = 1\n";
+	IniHandler handler = { CountSection, CountItem };
+	IniOptions options;
+	ParseCounts counts;
+	IniFile* file = NULL;
+
+	IniOptions_SetDefaults(&options);
+	options.validateUtf8 = true;
+
+	file = IniFile_ReadBuffer(bom, strlen(bom), &options);
+
+	ASSERT_NOT_NULL(file);
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, NULL, "name"), "caf\xC3\xA9");
+
+	IniFile_Free(file);
+
+	memset(&counts, 0, sizeof(counts));
+
+	ASSERT_FALSE(IniFile_Parse(overlong, strlen(overlong), &options,
+		&handler, &counts));
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorCode, DM_INI_ERROR_CODE_BAD_UTF8);
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorOffset, 10);
+
+	ASSERT_FALSE(IniFile_Parse(surrogate, strlen(surrogate), &options,
+		&handler, &counts));
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorOffset, 7);
+
+	ASSERT_FALSE(IniFile_Parse(truncated, strlen(truncated), &options,
+		&handler, &counts));
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorOffset, 34);
+
+	/* Found by the scans for the line and comment ends, then checked. */
+	ASSERT_FALSE(IniFile_Parse(longLine, strlen(longLine), &options,
+		&handler, &counts));
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorOffset, 42);
+
+	ASSERT_FALSE(IniFile_Parse(longComment, strlen(longComment), &options,
+		&handler, &counts));
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorOffset, 31);
+
+	ASSERT_FALSE(IniFile_Parse(afterComment, strlen(afterComment), &options,
+		&handler, &counts));
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorOffset, 15);
+
+	options.nestedComments = true;
+
+	ASSERT_FALSE(IniFile_Parse(longComment, strlen(longComment), &options,
+		&handler, &counts));
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorOffset, 31);
+
+	options.nestedComments = false;
+
+	/* Without the option the bytes are passed through untouched. */
+	options.validateUtf8 = false;
+
+	ASSERT_TRUE(IniFile_Parse(overlong, strlen(overlong), &options,
+		&handler, &counts));
+
+	return TEST_SUCCESS;
+}
+
+/* Encodes ASCII text as UTF-16 with a byte order mark. */
+static size_t EncodeUtf16(const char* text, bool bigEndian, char* out)
+{
+	size_t length = 0;
+
+	out[length++] = bigEndian ? '\xFE' : '\xFF';
+	out[length++] = bigEndian ? '\xFF' : '\xFE';
+
+	for (; *text; ++text)
+	{
+		out[length++] = bigEndian ? 0 : *text;
+		out[length++] = bigEndian ? *text : 0;
+	}
+
+	return length;
+}
+
+int TestUtf16()
+{
+	/* "[s]\nname = caf\u00E9 \u20AC \U0001F600\n" */
+	const char little[] =
+		"\xFF\xFE[\0s\0]\0\n\0n\0a\0m\0e\0 \0=\0 \0c\0a\0f\0\xE9\0 \0"
+		"\xAC\x20 \0\x3D\xD8\x00\xDE\n\0";
+	const char lonely[] = "\xFF\xFEk\0=\0\x00\xDCx\0";
+	char big[256];
+	char* large = NULL;
+	size_t length = 0;
+	size_t i;
+	IniHandler handler = { CountSection, CountItem };
+	ParseCounts counts;
+	IniSpan span;
+	char written[64];
+	char* text = NULL;
+	IniFile* file = NULL;
+	FILE* fp = NULL;
+
+	file = IniFile_ReadBuffer(little, sizeof(little) - 1, NULL);
+
+	ASSERT_NOT_NULL(file);
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, "s", "name"),
+		"caf\xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80");
+
+	IniFile_Free(file);
+
+	length = EncodeUtf16("[s]\nname = value\n", true, big);
+	file = IniFile_ReadBuffer(big, length, NULL);
+
+	ASSERT_NOT_NULL(file);
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, "s", "name"), "value");
+
+	IniFile_Free(file);
+
+	ASSERT_NULL(IniFile_ReadBuffer(lonely, sizeof(lonely) - 1, NULL));
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorCode,
+		DM_INI_ERROR_CODE_BAD_UTF16);
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorOffset, 6);
+
+	ASSERT_NULL(IniFile_ReadBuffer(big, length - 1, NULL));
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorCode,
+		DM_INI_ERROR_CODE_BAD_UTF16);
+
+	/* A file spanning many read chunks, with pairs split between them. */
+	large = malloc(65536);
+
+	ASSERT_NOT_NULL(large);
+
+	length = EncodeUtf16("[s]\n", false, large);
+
+	for (i = 0; i < 5000; ++i)
+	{
+		memcpy(large + length, "k\0=\0\x3D\xD8\x00\xDE\n\0", 10);
+		length += 10;
+	}
+
+	i = EncodeUtf16("last = x\n", false, big);
+	memcpy(large + length, big + 2, i - 2);
+	length += i - 2;
+
+	fp = fopen("utf16.ini", "wb");
+
+	ASSERT_NOT_NULL(fp);
+	ASSERT_EQUALS(fwrite(large, 1, length, fp), length);
+
+	fclose(fp);
+	free(large);
+
+	file = IniFile_ReadFile("utf16.ini");
+	remove("utf16.ini");
+
+	ASSERT_NOT_NULL(file);
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, "s", "k"), "\xF0\x9F\x98\x80");
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, "s", "last"), "x");
+
+	IniFile_Free(file);
+
+	/* The streaming entry points convert it the same way. */
+	memset(&counts, 0, sizeof(counts));
+
+	ASSERT_TRUE(IniFile_Parse(little, sizeof(little) - 1, NULL, &handler,
+		&counts));
+	ASSERT_EQUALS(counts.sections, 1);
+	ASSERT_STR_EQUALS(counts.lastKey, "name");
+
+	ASSERT_FALSE(IniFile_Parse(lonely, sizeof(lonely) - 1, NULL, &handler,
+		&counts));
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorCode,
+		DM_INI_ERROR_CODE_BAD_UTF16);
+
+	length = EncodeUtf16("[s]\nname = value\n", false, big);
+	fp = tmpfile();
+
+	ASSERT_NOT_NULL(fp);
+	ASSERT_TRUE(IniFile_ParseToJson(big, length, NULL, 0, fp));
+
+	rewind(fp);
+	i = fread(written, 1, sizeof(written) - 1, fp);
+	written[i] = '\0';
+	fclose(fp);
+
+	ASSERT_STR_EQUALS(written, "{\"s\":{\"name\":\"value\"}}\n");
+
+	/* Its text has to point into the buffer, so it is refused instead. */
+	ASSERT_FALSE(IniFile_FindSectionText(big, length, "s", 1, NULL, &span));
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorCode,
+		DM_INI_ERROR_CODE_BAD_UTF16);
+
+	ASSERT_TRUE(__IniFile_DecodeUtf16(big, length, NULL, &text, &i));
+	ASSERT_NOT_NULL(text);
+	ASSERT_EQUALS(i, 17);
+	ASSERT_STR_EQUALS(text, "[s]\nname = value\n");
+	ASSERT_TRUE(IniFile_FindSectionText(text, i, "s", 1, NULL, &span));
+
+	__IniAllocator_Free(NULL, text);
+
+	ASSERT_TRUE(__IniFile_DecodeUtf16("k = v\n", 6, NULL, &text, &i));
+	ASSERT_NULL(text);
+
+	return TEST_SUCCESS;
+}
+
+int TestDialect()
+{
+	const char* configparser =
+		"[server]\n"
+		"host: example.com\n"
+		"port = 8080 ; the usual\n"
+		"path = a;b\n"
+		"url = http://x\n";
+	const char* legacy =
+		"! comment\n"
+		"<main>\n"
+		"name: value # not a comment\n"
+		"// not a comment: either\n";
+	IniDialect dialect;
+	IniOptions options;
+	IniFile* file = NULL;
+
+	IniOptions_SetDefaults(&options);
+	options.dialect = &dialect;
+
+	IniDialect_SetDefaults(&dialect);
+	dialect.separators = "=:";
+	dialect.inlineComments = true;
+	dialect.slashComments = false;
+
+	ASSERT_TRUE(IniDialect_Compile(&dialect));
+
+	file = IniFile_ReadBuffer(configparser, strlen(configparser), &options);
+
+	ASSERT_NOT_NULL(file);
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, "server", "host"), "example.com");
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, "server", "port"), "8080");
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, "server", "path"), "a;b");
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, "server", "url"), "http://x");
+
+	IniFile_Free(file);
+
+	IniDialect_SetDefaults(&dialect);
+	dialect.commentPrefixes = "!";
+	dialect.separators = ":";
+	dialect.sectionOpen = '<';
+	dialect.sectionClose = '>';
+	dialect.slashComments = false;
+
+	ASSERT_TRUE(IniDialect_Compile(&dialect));
+
+	file = IniFile_ReadBuffer(legacy, strlen(legacy), &options);
+
+	ASSERT_NOT_NULL(file);
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, "main", "name"),
+		"value # not a comment");
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, "main", "// not a comment"),
+		"either");
+
+	IniFile_Free(file);
+
+	/* The default dialect does not know any of this. */
+	ASSERT_NULL(IniFile_ReadBuffer(legacy, strlen(legacy), NULL));
+
+	IniDialect_SetDefaults(&dialect);
+	dialect.commentPrefixes = "#;=";
+
+	ASSERT_FALSE(IniDialect_Compile(&dialect));
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorCode,
+		DM_INI_ERROR_CODE_BAD_DIALECT);
+
+	return TEST_SUCCESS;
+}
+
+int TestDuplicateKeys()
+{
+	const char* text =
+		"[s]\n"
+		"k = 1\n"
+		"other = x\n"
+		"k = 2\n"
+		"k = \"3\"\n";
+	IniOptions options;
+	IniFile* file = NULL;
+	const IniSpan* elements = NULL;
+	size_t count = 0;
+	char name[16];
+	char many[64 * 16];
+	size_t length = 0;
+	size_t i;
+
+	IniOptions_SetDefaults(&options);
+
+	file = IniFile_ReadBuffer(text, strlen(text), &options);
+
+	ASSERT_NOT_NULL(file);
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, "s", "k"), "1");
+	ASSERT_EQUALS(IniFile_GetSection(file, "s")->itemCount, 2);
+
+	IniFile_Free(file);
+
+	options.duplicateKeys = IniDuplicate_LastWins;
+	file = IniFile_ReadBuffer(text, strlen(text), &options);
+
+	ASSERT_NOT_NULL(file);
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, "s", "k"), "3");
+	ASSERT_EQUALS(IniFile_GetSection(file, "s")->itemCount, 2);
+
+	IniFile_Free(file);
+
+	options.duplicateKeys = IniDuplicate_Collect;
+	file = IniFile_ReadBuffer(text, strlen(text), &options);
+
+	ASSERT_NOT_NULL(file);
+	ASSERT_TRUE(IniFile_GetArray(file, "s", "k", &elements, &count));
+	ASSERT_EQUALS(count, 3);
+	ASSERT_TRUE((elements[0].length == 1 && elements[0].data[0] == '1'));
+	ASSERT_TRUE((elements[2].length == 1 && elements[2].data[0] == '3'));
+
+	IniFile_Free(file);
+
+	options.duplicateKeys = IniDuplicate_Error;
+
+	ASSERT_NULL(IniFile_ReadBuffer(text, strlen(text), &options));
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorCode,
+		DM_INI_ERROR_CODE_DUPLICATE_KEY);
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorOffset, 20);
+
+	/* Enough keys to grow the index while duplicates keep arriving. */
+	for (i = 0; i < 60; ++i)
+	{
+		sprintf(name, "k%u = %u\n", (unsigned int)(i % 40), (unsigned int)i);
+		memcpy(many + length, name, strlen(name));
+		length += strlen(name);
+	}
+
+	options.duplicateKeys = IniDuplicate_LastWins;
+	file = IniFile_ReadBuffer(many, length, &options);
+
+	ASSERT_NOT_NULL(file);
+	ASSERT_EQUALS(file->globalSection.itemCount, 40);
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, NULL, "k5"), "45");
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, NULL, "k25"), "25");
+
+	IniFile_Free(file);
+
+	return TEST_SUCCESS;
+}
+
+int TestReopenedSections()
+{
+	char text[200 * 24];
+	char name[16];
+	size_t length = 0;
+	IniFile* file = NULL;
+	IniSection* section = NULL;
+	size_t i;
+
+	/* Every section is opened four times, interleaved with the others. */
+	for (i = 0; i < 200; ++i)
+	{
+		length += sprintf(text + length, "[s%u]\nk%u = %u\n",
+			(unsigned int)(i % 50), (unsigned int)(i / 50), (unsigned int)i);
+	}
+
+	file = IniFile_ReadBuffer(text, length, NULL);
+
+	ASSERT_NOT_NULL(file);
+	ASSERT_EQUALS(IniFile_SectionCount(file), 50);
+
+	section = IniFile_GetSection(file, "s7");
+
+	ASSERT_NOT_NULL(section);
+	ASSERT_EQUALS(section->itemCount, 4);
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, "s7", "k3"), "157");
+
+	/* Removing moves the last section into the gap, the index follows. */
+	for (i = 0; i < 50; i += 2)
+	{
+		sprintf(name, "s%u", (unsigned int)i);
+
+		ASSERT_TRUE(IniFile_RemoveSection(file, name));
+	}
+
+	ASSERT_EQUALS(IniFile_SectionCount(file), 25);
+	ASSERT_NULL(IniFile_GetSection(file, "s48"));
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, "s49", "k0"), "49");
+	ASSERT_NOT_NULL(IniFile_AddSection(file, "s0"));
+	ASSERT_EQUALS(IniFile_SectionCount(file), 26);
+	ASSERT_TRUE((IniFile_AddSection(file, "s1") == IniFile_GetSection(file, "s1")));
+
+	IniFile_Free(file);
+
+	return TEST_SUCCESS;
+}
+
+int TestErrorLocation()
+{
+	IniOptions options;
+	char text[4096];
+	size_t length = 0;
+	size_t i;
+
+	/* Long enough that the newlines are counted 16 bytes at a time. */
+	for (i = 0; i < 200; ++i)
+		length += sprintf(text + length, "key%u = value\n", (unsigned int)i);
+
+	length += sprintf(text + length, "  broken line\n[ok]\n");
+
+	ASSERT_FALSE(IniFile_Parse(text, length, NULL, NULL, NULL));
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorCode, DM_INI_ERROR_CODE_BAD_ITEM);
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorLine, 201);
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorColumn, 3);
+
+	ASSERT_NULL(IniFile_ReadBuffer("a = 1\r\n[b\r\n", 12, NULL));
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorOffset, 7);
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorLine, 2);
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorColumn, 1);
+
+	/* Found by the builder, after the values before it were stored. */
+	IniOptions_SetDefaults(&options);
+	options.duplicateKeys = IniDuplicate_Error;
+
+	ASSERT_NULL(IniFile_ReadBuffer("a = 1\nb = 2\n  a = 3\n", 20, &options));
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorCode, DM_INI_ERROR_CODE_DUPLICATE_KEY);
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorLine, 3);
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorColumn, 3);
+
+	__IniFile_SetErrorHint(DM_INI_ERROR_MESSAGE_MALLOC_FAIL, 7);
+
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorLine, 0);
+
+	return TEST_SUCCESS;
+}
+
+int TestDiagnostics()
+{
+	const char* text =
+		"good = 1\n"
+		"no separator here\n"
+		"[broken\n"
+		"quoted = \"never closed\n"
+		"[fine]\n"
+		"name = value\n"
+		"name = again\n"
+		"bad = \xC0\xAF\n"
+		"after = 2\n"
+		"/* runs off the end\n"
+		"lost = 3\n";
+	IniDiagnostics diagnostics;
+	IniOptions options;
+	IniFile* file = NULL;
+	FILE* fp = NULL;
+
+	fp = fopen("diagnostics.ini", "wb");
+
+	ASSERT_NOT_NULL(fp);
+
+	fputs(text, fp);
+	fclose(fp);
+
+	IniOptions_SetDefaults(&options);
+	options.validateUtf8 = true;
+	options.duplicateKeys = IniDuplicate_Error;
+
+	file = IniFile_ReadWithDiagnostics("diagnostics.ini", &options,
+		&diagnostics);
+	remove("diagnostics.ini");
+
+	ASSERT_NOT_NULL(file);
+	ASSERT_NULL(IniFile_GetErrorHint());
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, NULL, "good"), "1");
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, "fine", "name"), "value");
+	ASSERT_STR_EQUALS(IniFile_GetValue(file, "fine", "after"), "2");
+	ASSERT_NULL(IniFile_GetValue(file, "fine", "bad"));
+	ASSERT_NULL(IniFile_GetValue(file, "fine", "lost"));
+
+	ASSERT_EQUALS(diagnostics.count, 6);
+	ASSERT_EQUALS(diagnostics.list[0].errorCode, DM_INI_ERROR_CODE_BAD_ITEM);
+	ASSERT_EQUALS(diagnostics.list[0].errorLine, 2);
+	ASSERT_EQUALS(diagnostics.list[1].errorCode, DM_INI_ERROR_CODE_BAD_SECTION);
+	ASSERT_EQUALS(diagnostics.list[1].errorLine, 3);
+	ASSERT_EQUALS(diagnostics.list[2].errorCode,
+		DM_INI_ERROR_CODE_UNTERMINATED_QUOTE);
+	ASSERT_EQUALS(diagnostics.list[2].errorColumn, 10);
+	ASSERT_EQUALS(diagnostics.list[3].errorCode,
+		DM_INI_ERROR_CODE_DUPLICATE_KEY);
+	ASSERT_EQUALS(diagnostics.list[3].errorLine, 7);
+	ASSERT_EQUALS(diagnostics.list[4].errorCode, DM_INI_ERROR_CODE_BAD_UTF8);
+	ASSERT_EQUALS(diagnostics.list[4].errorColumn, 7);
+	ASSERT_EQUALS(diagnostics.list[5].errorCode,
+		DM_INI_ERROR_CODE_UNTERMINATED_COMMENT);
+	ASSERT_EQUALS(diagnostics.list[5].errorLine, 10);
+
+	IniDiagnostics_Free(&diagnostics);
+	IniFile_Free(file);
+
+	ASSERT_NULL(IniFile_ReadWithDiagnostics("missing.ini", NULL,
+		&diagnostics));
+	ASSERT_EQUALS(diagnostics.count, 0);
+
+	IniDiagnostics_Free(&diagnostics);
+
+	return TEST_SUCCESS;
+}
+
 int TestSection()
 {
 	const char* section1 = "[section1]";
@@ -168,6 +1708,12 @@ int TestSection()
 	return TEST_SUCCESS;
 }
 
+/* The C++ wrapper is tested in TestWrapper.cpp. */
+int TestCppFile();
+int TestCppErrors();
+int TestCppMemoryResource();
+int TestCppStaticFile();
+
 void RegisterTest(TestFunction tf, const char* title)
 {
 	int value = tf();
@@ -195,6 +1741,33 @@ int main(int argc, char* argv[])
 	RegisterTest(TestFileRead, "File Reading Functionality");
 	RegisterTest(TestHashing, "String Hashing Functionality");
 	RegisterTest(TestComments, "Comment Parsing Functionality");
+	RegisterTest(TestLineClassifier, "Line Classifier Functionality");
+	RegisterTest(TestBlockCommentLexer, "Block Comment Lexer Functionality");
+	RegisterTest(TestBlockCommentSkip, "Block Comment Skip Functionality");
+	RegisterTest(TestContinuation, "Value Continuation Functionality");
+	RegisterTest(TestQuotedValues, "Quoted Value Functionality");
+	RegisterTest(TestArrays, "Array Value Functionality");
+	RegisterTest(TestSectionTree, "Section Tree Functionality");
+	RegisterTest(TestSortedOrder, "Sorted Order Functionality");
+	RegisterTest(TestEditing, "Editing Functionality");
+	RegisterTest(TestCounts, "Count Functionality");
+	RegisterTest(TestKeys, "Key Handle Functionality");
+	RegisterTest(TestAllocator, "Allocator Functionality");
+	RegisterTest(TestImage, "Image Functionality");
+	RegisterTest(TestValueConversion, "Value Conversion Functionality");
+	RegisterTest(TestSectionText, "Section Text Functionality");
+	RegisterTest(TestJson, "JSON Functionality");
+	RegisterTest(TestUtf8, "UTF-8 Functionality");
+	RegisterTest(TestUtf16, "UTF-16 Functionality");
+	RegisterTest(TestDialect, "Dialect Functionality");
+	RegisterTest(TestDuplicateKeys, "Duplicate Key Functionality");
+	RegisterTest(TestReopenedSections, "Reopened Section Functionality");
+	RegisterTest(TestErrorLocation, "Error Location Functionality");
+	RegisterTest(TestDiagnostics, "Diagnostics Functionality");
+	RegisterTest(TestCppFile, "C++ File Functionality");
+	RegisterTest(TestCppErrors, "C++ Error Functionality");
+	RegisterTest(TestCppMemoryResource, "C++ Memory Resource Functionality");
+	RegisterTest(TestCppStaticFile, "C++ Static File Functionality");
 	RegisterTest(TestSection, "Section Parsing Functionality");
 
 	return 0;
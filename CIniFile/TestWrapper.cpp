@@ -0,0 +1,358 @@
+/**
+ * TestWrapper.cpp - Tests of the C++ wrapper in IniFile.hpp.
+ *
+ * CIniFile: C implementation of reading ini configuration files.
+ * An open source project of HYPEWORKS.
+ *
+ * Copyright (C) 2017-2021 HYPEWORKS Ltd Co.
+ */
+
+/*
+ * This software library is open source and licensed under the MIT License.
+ *
+ * Read LICENSE for the full license text.
+ */
+
+#include "IniFile.hpp"
+#include "Test.h"
+
+#include <map>
+#include <string>
+#include <utility>
+
+namespace
+{
+	// Counts the blocks handed out, and checks that each one comes back with
+	// the size and alignment it went out with.
+	class CountingResource : public std::pmr::memory_resource
+	{
+	public:
+		size_t allocations = 0;
+		size_t deallocations = 0;
+		size_t mismatches = 0;
+		std::map<void*, std::pair<size_t, size_t>> live;
+
+	private:
+		void* do_allocate(size_t bytes, size_t alignment) override
+		{
+			void* pointer = std::pmr::new_delete_resource()->allocate(bytes,
+				alignment);
+
+			live[pointer] = std::make_pair(bytes, alignment);
+			allocations++;
+
+			return pointer;
+		}
+
+		void do_deallocate(void* pointer, size_t bytes,
+			size_t alignment) override
+		{
+			auto block = live.find(pointer);
+
+			deallocations++;
+
+			if (block == live.end())
+			{
+				mismatches++;
+
+				return;
+			}
+
+			if (block->second != std::make_pair(bytes, alignment))
+				mismatches++;
+
+			// Give back what was really taken, whatever we were told.
+			std::pmr::new_delete_resource()->deallocate(pointer,
+				block->second.first, block->second.second);
+			live.erase(block);
+		}
+
+		bool do_is_equal(
+			const std::pmr::memory_resource& other) const noexcept override
+		{
+			return this == &other;
+		}
+	};
+}
+
+// Evaluated while compiling, so a mistake here fails the build.
+constexpr std::string_view staticText = R"(
+; Parsed at compile time.
+name = global
+
+[server]
+host = example.org
+port = 8080
+/* comment = not an item
+hidden = no */
+ports[] = 80
+ports[] = 443
+
+[limits]
+min = -128
+)";
+
+constexpr auto staticFile = ini::parse<ini::itemCount(staticText)>(
+	staticText);
+
+static_assert(ini::itemCount(staticText) == 6);
+static_assert(ini::itemCount("") == 0);
+static_assert(sizeof(staticFile) == sizeof(ini::StaticFile<6>));
+static_assert(staticFile.size() == 6);
+static_assert(*staticFile.get<std::string_view>("", "name") == "global");
+static_assert(*staticFile.get<int>("server", "port") == 8080);
+static_assert(*staticFile.get<std::string_view>("server", "ports") == "80");
+static_assert(*staticFile.get<signed char>("limits", "min") == -128);
+static_assert(!staticFile.get<unsigned char>("limits", "min"));
+static_assert(!staticFile.find("server", "hidden"));
+static_assert(!staticFile.find("limits", "port"));
+
+// The literal form needs no name for the text, at the cost of a larger table.
+constexpr auto literalFile = ini::parse(R"(
+[server]
+port = 8080
+)");
+
+static_assert(literalFile.size() == 1);
+static_assert(*literalFile.get<int>("server", "port") == 8080);
+static_assert(std::is_same_v<decltype(ini::parse<1>("k = v")),
+	ini::StaticFile<1>>);
+
+extern "C" int TestCppStaticFile()
+{
+	size_t items = 0;
+
+	for (const auto& entry : staticFile)
+		items += entry.section == "server";
+
+	ASSERT_EQUALS(items, 4);
+
+	// The same parser at run time throws where it would fail the build.
+	try
+	{
+		ini::parse<2>("a = 1\n\n[b\n");
+		ASSERT()
+	}
+	catch (const ini::ParseError& error)
+	{
+		ASSERT_EQUALS(error.line(), 3);
+		ASSERT_STR_EQUALS(error.what(), DM_INI_ERROR_MESSAGE_BAD_SECTION);
+	}
+
+	try
+	{
+		ini::parse<1>("a = 1\nb = 2\n");
+		ASSERT()
+	}
+	catch (const ini::ParseError& error)
+	{
+		ASSERT_EQUALS(error.line(), 2);
+	}
+
+	try
+	{
+		ini::itemCount("a = 1\n/* never closed\n");
+		ASSERT()
+	}
+	catch (const ini::ParseError& error)
+	{
+		ASSERT_EQUALS(error.line(), 2);
+	}
+
+	// Both parsers find the same value, or both reject the text.
+	const char* parity[] =
+	{
+		"\xEF\xBB\xBF[a]\nk = v\n",
+		"[a]\nk = \"a b\" ; note\n",
+		"[a]\nk = \"a b\"# note\n",
+		"[a]\nk = \"a b\" // note\n",
+		"[a]\nk = v ; note\n",
+		"[a]\nk[] = 1\nk[] = 2\n",
+		"[a]\n/* x */ k = v /* y */\n",
+		"[ a ] trailing\n  k  =  v  \n",
+	};
+
+	for (const char* text : parity)
+	{
+		ini::File file = ini::File::parse(text);
+		std::optional<std::string_view> value;
+
+		try
+		{
+			value = ini::parse<4>(text).find("a", "k");
+			ASSERT_TRUE(static_cast<bool>(file));
+			ASSERT_TRUE(value.has_value());
+			ASSERT_TRUE(*value == file.find("a", "k").value());
+		}
+		catch (const ini::ParseError& error)
+		{
+			ASSERT_FALSE(static_cast<bool>(file));
+			ASSERT_STR_EQUALS(error.what(), IniFile_GetErrorHint()->errorText);
+		}
+	}
+
+	// Escapes only matter between the quotes.
+	ASSERT_TRUE(*ini::parse<1>("k = \"a\" ; C:\\dir\n").find("", "k") == "a");
+
+	return TEST_SUCCESS;
+}
+
+extern "C" int TestCppFile()
+{
+	constexpr std::string_view text =
+		"name = global\n"
+		"[server]\n"
+		"host = example.org\n"
+		"port = 8080\n"
+		"ports[] = 80\n"
+		"ports[] = 443\n"
+		"verbose = yes\n";
+	static constexpr ini::Key port{ "port" };
+
+	ini::File file = ini::File::parse(text);
+
+	ASSERT_TRUE(static_cast<bool>(file));
+	ASSERT_EQUALS(file.sectionCount(), 1);
+	ASSERT_TRUE(file.sectionAt(0).name() == "server");
+
+	// An empty name is the global items, as in StaticFile::find().
+	ASSERT_TRUE(file.global().get() == file.section("").get());
+	ASSERT_TRUE(file.global().name().empty());
+	ASSERT_TRUE(file.get<std::string_view>("", "name") == "global");
+	ASSERT_TRUE(file.find("", "name").key() == "name");
+
+	ASSERT_TRUE(file.get<int>("server", port) == 8080);
+	ASSERT_TRUE(file.get<bool>("server", "verbose") == true);
+	ASSERT_STR_EQUALS(*file.get<const char*>("server", "host"), "example.org");
+	ASSERT_TRUE(file.get<std::string_view>("server", "ports") == "80");
+
+	ini::Section server = file.section("server");
+	std::string keys;
+
+	ASSERT_EQUALS(server.size(), 4);
+	ASSERT_TRUE(server.at(1).value() == "8080");
+
+	for (ini::Item item : server)
+		keys += std::string(item.key()) + ";";
+
+	ASSERT_TRUE(keys == "host;port;ports;verbose;");
+
+	ASSERT_TRUE(file.set("server", "port", "9090"));
+	ASSERT_TRUE(file.get<long>("server", port) == 9090);
+
+	ini::File moved = std::move(file);
+
+	ASSERT_FALSE(static_cast<bool>(file));
+	ASSERT_TRUE(moved.get<double>("server", "port") == 9090.0);
+
+	IniFile_Free(moved.release());
+
+	ASSERT_FALSE(static_cast<bool>(moved));
+
+	return TEST_SUCCESS;
+}
+
+extern "C" int TestCppErrors()
+{
+	ini::File missing = ini::File::read("does not exist.ini");
+
+	ASSERT_FALSE(static_cast<bool>(missing));
+	ASSERT_NOT_NULL(IniFile_GetErrorHint());
+
+	ini::File broken = ini::File::parse("a = 1\n[b\n");
+
+	ASSERT_FALSE(static_cast<bool>(broken));
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorCode,
+		DM_INI_ERROR_CODE_BAD_SECTION);
+	ASSERT_EQUALS(IniFile_GetErrorHint()->errorLine, 2);
+
+	ini::File file = ini::File::parse("[s]\nnumber = 12x\nbig = 300\n"
+		"flag = maybe\nempty =\n");
+
+	ASSERT_TRUE(static_cast<bool>(file));
+
+	// Missing sections and items come back empty rather than failing.
+	ASSERT_FALSE(static_cast<bool>(file.section("nope")));
+	ASSERT_FALSE(static_cast<bool>(file.find("nope", "number")));
+	ASSERT_FALSE(static_cast<bool>(file.find("s", "nope")));
+	ASSERT_FALSE(file.get<int>("nope", "number").has_value());
+	ASSERT_EQUALS(file.section("nope").size(), 0);
+	ASSERT_TRUE(file.find("s", "nope").value().empty());
+	ASSERT_TRUE(file.find("s", "nope").key().empty());
+	ASSERT_TRUE(file.section("nope").name().empty());
+	ASSERT_TRUE(ini::Item().key().empty());
+	ASSERT_TRUE(ini::Section().name().empty());
+
+	// Values that do not convert.
+	ASSERT_FALSE(file.get<int>("s", "number").has_value());
+	ASSERT_FALSE(file.get<unsigned char>("s", "big").has_value());
+	ASSERT_FALSE(file.get<bool>("s", "flag").has_value());
+	ASSERT_FALSE(file.get<double>("s", "empty").has_value());
+	ASSERT_TRUE(file.get<std::string_view>("s", "empty") == "");
+
+	return TEST_SUCCESS;
+}
+
+extern "C" int TestCppMemoryResource()
+{
+	constexpr std::string_view text =
+		"[server]\n"
+		"motd = Welcome to \\\n"
+		"    the machine\n"
+		"path = \"C:\\\\ini\\tfiles\"\n"
+		"ports[] = 80\n"
+		"ports[] = 443\n"
+		"[server.backup]\n"
+		"host = example.org\n";
+	CountingResource resource;
+
+	{
+		ini::File file = ini::File::parse(text, &resource);
+
+		ASSERT_TRUE(static_cast<bool>(file));
+
+		// Joined and decoded on first use, from the same resource.
+		ASSERT_TRUE(file.get<std::string_view>("server", "motd") ==
+			"Welcome to the machine");
+		ASSERT_TRUE(file.get<std::string_view>("server", "path") ==
+			"C:\\ini\tfiles");
+		ASSERT_TRUE(file.set("server", "port", "8080"));
+		ASSERT_TRUE(file.set("client", "host", "example.com"));
+	}
+
+	{
+		ini::File file = ini::File::read("test.ini", &resource);
+
+		ASSERT_TRUE(file.get<std::string_view>("section2", "motd") ==
+			"Welcome to the machine");
+	}
+
+	// Every block came back once, with the size it was allocated with.
+	ASSERT_NOT_EQUALS(resource.allocations, 0);
+	ASSERT_EQUALS(resource.deallocations, resource.allocations);
+	ASSERT_EQUALS(resource.mismatches, 0);
+	ASSERT_TRUE(resource.live.empty());
+
+	// makeAllocator on its own, with the size round tripping through it.
+	IniAllocator allocator = ini::makeAllocator(&resource);
+	void* block = allocator.allocate(allocator.user, 24);
+
+	ASSERT_NOT_NULL(block);
+	ASSERT_TRUE(resource.live[block] ==
+		std::make_pair(size_t(24), alignof(std::max_align_t)));
+
+	allocator.deallocate(allocator.user, block, 24);
+
+	ASSERT_TRUE(resource.live.empty());
+	ASSERT_EQUALS(resource.mismatches, 0);
+
+	// A resource that throws is out of memory, not a crash.
+	ini::File failed = ini::File::parse(text,
+		std::pmr::null_memory_resource());
+
+	ASSERT_FALSE(static_cast<bool>(failed));
+	ASSERT_STR_EQUALS(IniFile_GetErrorHint()->errorText,
+		DM_INI_ERROR_MESSAGE_MALLOC_FAIL);
+
+	return TEST_SUCCESS;
+}
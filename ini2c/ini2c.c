@@ -0,0 +1,92 @@
+/**
+ * ini2c.c - Compiles an ini file into C source.
+ *
+ * CIniFile: C implementation of reading ini configuration files.
+ * An open source project of HYPEWORKS.
+ *
+ * Copyright (C) 2017-2021 HYPEWORKS Ltd Co.
+ */
+
+/*
+ * This software library is open source and licensed under the MIT License.
+ *
+ * Read LICENSE for the full license text.
+ */
+
+/*
+ * Usage: ini2c <input.ini> <output.c> <name>
+ *
+ * The output defines "const IniImage <name>" for a program to declare as
+ * extern and look up with IniImage_Find() or IniImage_GetValue(), so its
+ * built in configuration is ready without being parsed at startup.
+ */
+
+#include "../CIniFile/IniFile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static int ReportError(const char* what, const char* path)
+{
+	IniErrorHint* hint = IniFile_GetErrorHint();
+
+	fprintf(stderr, "ini2c: %s %s", what, path);
+
+	if (hint && hint->errorText)
+		fprintf(stderr, ": %s (%d)", hint->errorText, hint->errorCode);
+
+	fputc('\n', stderr);
+
+	return EXIT_FAILURE;
+}
+
+int main(int argc, char** argv)
+{
+	IniFile* file = NULL;
+	IniImage* image = NULL;
+	FILE* fp = NULL;
+	int result = EXIT_SUCCESS;
+
+	if (argc != 4)
+	{
+		fprintf(stderr, "usage: ini2c <input.ini> <output.c> <name>\n");
+
+		return EXIT_FAILURE;
+	}
+
+	file = IniFile_ReadFile(argv[1]);
+
+	if (!file)
+		return ReportError("could not read", argv[1]);
+
+	image = IniImage_Build(file);
+
+	if (!image)
+	{
+		result = ReportError("could not build an image of", argv[1]);
+
+		IniFile_Free(file);
+
+		return result;
+	}
+
+	fp = fopen(argv[2], "w");
+
+	if (!fp)
+	{
+		result = ReportError("could not open", argv[2]);
+	}
+	else
+	{
+		if (!IniImage_Write(image, fp, argv[3]))
+			result = ReportError("could not write", argv[2]);
+
+		if (fclose(fp) != 0 && result == EXIT_SUCCESS)
+			result = ReportError("could not write", argv[2]);
+	}
+
+	IniImage_Free(image);
+	IniFile_Free(file);
+
+	return result;
+}
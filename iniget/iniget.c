@@ -0,0 +1,390 @@
+/**
+ * iniget.c - Prints one value from an ini file.
+ *
+ * CIniFile: C implementation of reading ini configuration files.
+ * An open source project of HYPEWORKS.
+ *
+ * Copyright (C) 2017-2021 HYPEWORKS Ltd Co.
+ */
+
+/*
+ * This software library is open source and licensed under the MIT License.
+ *
+ * Read LICENSE for the full license text.
+ */
+
+/*
+ * Usage: iniget <file.ini> <section> <key>
+ *
+ * Pass "" as the section for the global items. Prints the value followed by
+ * a newline and exits with 0, exits with 1 if there is no such item and 2
+ * on any other error.
+ *
+ * Meant to be run many times from scripts, so it maps the file instead of
+ * reading it and only parses the section asked for. Every other line is
+ * looked at just far enough to tell that it does not declare a section.
+ *
+ * A file that starts with a UTF-16 byte order mark is converted to UTF-8
+ * in memory first.
+ *
+ * Lines of that section that do not parse are reported on stderr and
+ * skipped, as IniFile_ReadWithDiagnostics() does, so they do not hide a
+ * value further down. If the value is not found after that, the exit code is
+ * 2, since it may have been on one of them.
+ */
+
+#include "../CIniFile/IniFile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define INIGET_FOUND 0
+#define INIGET_MISSING 1
+#define INIGET_ERROR 2
+
+typedef struct
+{
+	const char* data;
+	size_t length;
+
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#endif
+} MappedFile;
+
+/* Maps a whole file read only. An empty file maps to an empty buffer. */
+static bool MapFile(const char* path, MappedFile* mapped)
+{
+#ifdef _WIN32
+	LARGE_INTEGER size;
+#else
+	struct stat status;
+	void* data = NULL;
+	int fd = -1;
+#endif
+
+	memset(mapped, 0, sizeof(*mapped));
+	mapped->data = "";
+
+#ifdef _WIN32
+	mapped->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+
+	if (mapped->file == INVALID_HANDLE_VALUE)
+		return false;
+
+	if (!GetFileSizeEx(mapped->file, &size))
+	{
+		CloseHandle(mapped->file);
+
+		return false;
+	}
+
+	if (size.QuadPart == 0)
+		return true;
+
+	mapped->mapping = CreateFileMappingA(mapped->file, NULL, PAGE_READONLY, 0,
+		0, NULL);
+
+	if (mapped->mapping)
+		mapped->data = MapViewOfFile(mapped->mapping, FILE_MAP_READ, 0, 0, 0);
+
+	if (!mapped->mapping || !mapped->data)
+	{
+		if (mapped->mapping)
+			CloseHandle(mapped->mapping);
+
+		CloseHandle(mapped->file);
+
+		return false;
+	}
+
+	mapped->length = (size_t)size.QuadPart;
+#else
+	fd = open(path, O_RDONLY);
+
+	if (fd < 0)
+		return false;
+
+	if (fstat(fd, &status) != 0)
+	{
+		close(fd);
+
+		return false;
+	}
+
+	if (status.st_size > 0)
+	{
+		data = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		if (data == MAP_FAILED)
+		{
+			close(fd);
+
+			return false;
+		}
+
+		mapped->data = data;
+		mapped->length = (size_t)status.st_size;
+	}
+
+	/* The mapping stays valid without the descriptor. */
+	close(fd);
+#endif
+
+	return true;
+}
+
+static void UnmapFile(MappedFile* mapped)
+{
+#ifdef _WIN32
+	if (mapped->mapping)
+	{
+		UnmapViewOfFile(mapped->data);
+		CloseHandle(mapped->mapping);
+	}
+
+	CloseHandle(mapped->file);
+#else
+	if (mapped->length)
+		munmap((void*)mapped->data, mapped->length);
+#endif
+}
+
+typedef struct
+{
+	const char* key;
+	size_t keyLength;
+	bool found;
+	bool failed;
+} Query;
+
+static bool PrintValue(void* user, IniSpan key, const IniValue* value)
+{
+	Query* query = (Query*)user;
+	size_t length = 0;
+	char* text = NULL;
+
+	/* Repeated "key[]" items are elements of the array "key", as in
+	 * __IniFileBuilder_OnItem(). */
+	if (key.length >= 2 && key.data[key.length - 2] == DM_LEFT_BRACKET &&
+		key.data[key.length - 1] == DM_RIGHT_BRACKET)
+	{
+		key.length -= 2;
+	}
+
+	if (key.length != query->keyLength ||
+		memcmp(key.data, query->key, key.length) != 0)
+	{
+		return true;
+	}
+
+	/* The spans only last until this returns. */
+	length = IniValue_Join(value, NULL);
+	text = malloc(length + 1);
+
+	if (!text)
+	{
+		query->failed = true;
+
+		return false;
+	}
+
+	IniValue_Join(value, text);
+	text[length] = '\n';
+
+	query->found = true;
+	query->failed = fwrite(text, 1, length + 1, stdout) != length + 1;
+
+	free(text);
+
+	/* The first of several equal keys wins, as in IniFile_GetValue(). */
+	return false;
+}
+
+/*
+ * The hint is located in the text that was parsed, which starts at base.
+ * Moves it to its place in the whole file.
+ */
+static void LocateError(IniSpan file, const char* base, IniErrorHint* hint)
+{
+	const char* newline = NULL;
+	size_t offset = 0;
+	size_t start = 0;
+	size_t line = 1;
+
+	if (!hint || hint->errorOffset == DM_INI_NO_OFFSET)
+		return;
+
+	offset = hint->errorOffset + (size_t)(base - file.data);
+
+	if (offset > file.length)
+		return;
+
+	while ((newline = memchr(file.data + start, '\n', offset - start)))
+	{
+		start = (size_t)(newline - file.data) + 1;
+		++line;
+	}
+
+	hint->errorOffset = offset;
+	hint->errorLine = line;
+	hint->errorColumn = offset - start + 1;
+}
+
+static int ReportError(const char* what, const char* path, IniSpan file,
+	const char* base, IniErrorHint* hint)
+{
+	LocateError(file, base, hint);
+
+	fprintf(stderr, "iniget: %s %s", what, path);
+
+	if (hint && hint->errorLine)
+	{
+		fprintf(stderr, ":%lu:%lu", (unsigned long)hint->errorLine,
+			(unsigned long)hint->errorColumn);
+	}
+
+	if (hint && hint->errorText)
+		fprintf(stderr, ": %s (%d)", hint->errorText, hint->errorCode);
+
+	fputc('\n', stderr);
+
+	return INIGET_ERROR;
+}
+
+int main(int argc, char** argv)
+{
+	MappedFile mapped;
+	IniSpan file;
+	char* decoded = NULL;
+	size_t decodedLength = 0;
+	IniHandler handler = { NULL, PrintValue };
+	Query query;
+	const char* section = NULL;
+	size_t sectionLength = 0;
+	size_t position = 0;
+	IniSpan text;
+	IniDiagnostics diagnostics;
+	size_t reported = 0;
+	int result = INIGET_MISSING;
+
+	if (argc != 4)
+	{
+		fprintf(stderr, "usage: iniget <file.ini> <section> <key>\n");
+
+		return INIGET_ERROR;
+	}
+
+	if (argv[2][0])
+	{
+		section = argv[2];
+		sectionLength = strlen(section);
+	}
+
+	query.key = argv[3];
+	query.keyLength = strlen(argv[3]);
+	query.found = false;
+	query.failed = false;
+
+	memset(&diagnostics, 0, sizeof(diagnostics));
+
+	if (!MapFile(argv[1], &mapped))
+	{
+		fprintf(stderr, "iniget: could not open %s\n", argv[1]);
+
+		return INIGET_ERROR;
+	}
+
+	file.data = mapped.data;
+	file.length = mapped.length;
+
+	/* UTF-16 is searched as UTF-8, as IniFile_ReadBuffer() reads it. */
+	if (!__IniFile_DecodeUtf16(mapped.data, mapped.length, NULL, &decoded,
+		&decodedLength))
+	{
+		fprintf(stderr, "iniget: could not read %s: %s (%d)\n", argv[1],
+			IniFile_GetErrorHint()->errorText,
+			IniFile_GetErrorHint()->errorCode);
+		UnmapFile(&mapped);
+
+		return INIGET_ERROR;
+	}
+
+	if (decoded)
+	{
+		file.data = decoded;
+		file.length = decodedLength;
+	}
+
+	/* A section declared more than once is searched in file order. */
+	while (IniFile_FindSectionText(file.data + position,
+		file.length - position, section, sectionLength, NULL, &text))
+	{
+		bool parsed = __IniFile_ParseWithDiagnostics(text.data, text.length,
+			NULL, &handler, &query, &diagnostics);
+
+		for (; reported < diagnostics.count; ++reported)
+		{
+			ReportError("skipped a line of", argv[1], file, text.data,
+				&diagnostics.list[reported]);
+		}
+
+		/* Only running out of memory stops it early, short of a match. */
+		if (!parsed && !query.found && !query.failed)
+		{
+			result = ReportError("could not parse", argv[1], file,
+				text.data, IniFile_GetErrorHint());
+
+			break;
+		}
+
+		if (query.failed)
+		{
+			fprintf(stderr, "iniget: %s\n", DM_INI_ERROR_MESSAGE_MALLOC_FAIL);
+			result = INIGET_ERROR;
+
+			break;
+		}
+
+		if (query.found)
+		{
+			result = INIGET_FOUND;
+
+			break;
+		}
+
+		/* The global items only come before the first declaration. */
+		if (!section)
+			break;
+
+		position = (size_t)(text.data + text.length - file.data);
+	}
+
+	if (result == INIGET_MISSING && IniFile_GetErrorHint() &&
+		IniFile_GetErrorHint()->errorText)
+	{
+		result = ReportError("could not parse", argv[1], file,
+			file.data + position, IniFile_GetErrorHint());
+	}
+
+	if (result == INIGET_MISSING && diagnostics.count)
+		result = INIGET_ERROR;
+
+	IniDiagnostics_Free(&diagnostics);
+	__IniAllocator_Free(NULL, decoded);
+	UnmapFile(&mapped);
+
+	return result;
+}
@@ -0,0 +1,64 @@
+#!/bin/sh
+#
+# Runs iniget on the files next to this script and checks what it prints.
+#
+# Usage: run.sh <path to iniget>
+
+iniget=$1
+dir=$(dirname "$0")
+errors=$(mktemp)
+failed=0
+
+# expect <exit code> <stdout> <stderr pattern> <file> <section> <key>
+# An empty pattern expects nothing on stderr.
+expect()
+{
+	code=$1
+	output=$2
+	pattern=$3
+	shift 3
+
+	actual=$("$iniget" "$dir/$1" "$2" "$3" 2>"$errors")
+	status=$?
+
+	if [ -z "$pattern" ] && [ -s "$errors" ]; then
+		status=-1
+	elif [ -n "$pattern" ] && ! grep -q -e "$pattern" "$errors"; then
+		status=-1
+	fi
+
+	if [ "$status" -ne "$code" ] || [ "$actual" != "$output" ]; then
+		echo "FAIL: iniget $1 '$2' '$3' exited with $status and printed '$actual'"
+		cat "$errors"
+		failed=1
+	fi
+}
+
+# Plain keys, array keys, a reopened section and the global items.
+expect 0 "global value" "" values.ini "" name
+expect 0 "from globals" "" values.ini "" shared
+expect 1 "" "" values.ini "" host
+expect 0 "example.org" "" values.ini server host
+expect 0 "8080" "" values.ini server port
+expect 0 "30" "" values.ini server timeout
+expect 0 "80" "" values.ini server ports
+expect 0 "from client" "" values.ini client shared
+expect 1 "" "" values.ini client host
+expect 1 "" "" values.ini missing host
+
+# Bad lines are skipped, and located in the whole file, not the section.
+expect 0 "4" "broken.ini:9:3: " broken.ini second d
+expect 2 "" "broken.ini:9:3: " broken.ini second missing
+expect 2 "" "broken.ini:14:1: " broken.ini first missing
+
+# UTF-16 is read as UTF-8, with locations counted in the converted text.
+expect 0 "café" "" utf16.ini s name
+expect 2 "" "utf16.ini:6:3: " utf16.ini t missing
+
+rm -f "$errors"
+
+if [ "$failed" -ne 0 ]; then
+	exit 1
+fi
+
+echo "iniget: OK"
@@ -0,0 +1,1200 @@
+/**
+ * inilint.c - Checks trees of ini files on every core.
+ *
+ * CIniFile: C implementation of reading ini configuration files.
+ * An open source project of HYPEWORKS.
+ *
+ * Copyright (C) 2017-2021 HYPEWORKS Ltd Co.
+ */
+
+/*
+ * This software library is open source and licensed under the MIT License.
+ *
+ * Read LICENSE for the full license text.
+ */
+
+/*
+ * Usage: inilint [-j threads] [-s schema.ini] <path>...
+ *
+ * Directories are searched recursively for files ending in .ini or .conf,
+ * any other path is checked as given. Each problem is printed as
+ * "path:line:column: message", files in the order they were found.
+ *
+ * Reports syntax errors, including block comments that are never closed,
+ * and keys set twice in the same section. With a schema, in the format
+ * inischema reads, it also reports sections and keys the schema does not
+ * declare and values that do not fit their type.
+ *
+ * Exits with 0 if every file is clean, 1 if there were problems and 2 if
+ * the check could not be run.
+ */
+
+/* lstat() is POSIX, which -std=c11 and the like leave out. */
+#ifndef _XOPEN_SOURCE
+#define _XOPEN_SOURCE 700
+#endif
+
+#include "../CIniFile/IniFile.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define INILINT_CLEAN 0
+#define INILINT_PROBLEMS 1
+#define INILINT_ERROR 2
+
+#ifdef _WIN32
+#define INILINT_PATH_SEPARATOR '\\'
+#else
+#define INILINT_PATH_SEPARATOR '/'
+#endif
+
+/* Reports */
+
+typedef struct
+{
+	char* text;
+	size_t length;
+	size_t capacity;
+
+	size_t problems;
+} Report;
+
+static bool Report_Append(Report* report, const char* format, va_list args)
+{
+	va_list copy;
+	int needed = 0;
+
+	va_copy(copy, args);
+	needed = vsnprintf(report->text ? report->text + report->length : NULL,
+		report->capacity - report->length, format, copy);
+	va_end(copy);
+
+	if (needed < 0)
+		return false;
+
+	if (report->length + (size_t)needed + 1 > report->capacity)
+	{
+		size_t capacity = report->capacity ? report->capacity * 2 : 256;
+		char* text = NULL;
+
+		while (capacity < report->length + (size_t)needed + 1)
+			capacity *= 2;
+
+		text = realloc(report->text, capacity);
+
+		if (!text)
+			return false;
+
+		report->text = text;
+		report->capacity = capacity;
+
+		vsnprintf(report->text + report->length,
+			report->capacity - report->length, format, args);
+	}
+
+	report->length += (size_t)needed;
+
+	return true;
+}
+
+static bool Report_Add(Report* report, const char* format, ...)
+{
+	va_list args;
+	bool result = false;
+
+	va_start(args, format);
+	result = Report_Append(report, format, args);
+	va_end(args);
+
+	return result;
+}
+
+/* Span tables */
+
+/*
+ * Open addressing table keyed by a (section, key) pair of spans. Slots are
+ * stamped with a generation, so emptying the table between files is one
+ * increment however large it has grown.
+ */
+typedef struct
+{
+	IniSpan section;
+	IniSpan key;
+	uint32_t hash;
+	uint32_t generation;
+	size_t value;
+} Slot;
+
+typedef struct
+{
+	Slot* slots;
+	size_t capacity;
+	size_t count;
+	uint32_t generation;
+} SpanTable;
+
+static uint32_t SpanTable_Hash(uint32_t sectionHash, IniSpan key)
+{
+	return __IniFile_HashSpan(key.data, key.length) ^
+		(sectionHash * 0x9E3779B1u);
+}
+
+static bool Span_Equals(IniSpan a, IniSpan b)
+{
+	return a.length == b.length &&
+		(a.length == 0 || memcmp(a.data, b.data, a.length) == 0);
+}
+
+/* Finds the slot of a pair, or the empty slot it would go in. */
+static Slot* SpanTable_Slot(const SpanTable* table, IniSpan section,
+	IniSpan key, uint32_t hash)
+{
+	size_t mask = table->capacity - 1;
+	size_t i = hash & mask;
+
+	for (;;)
+	{
+		Slot* slot = &table->slots[i];
+
+		if (slot->generation != table->generation)
+			return slot;
+
+		if (slot->hash == hash && Span_Equals(slot->key, key) &&
+			Span_Equals(slot->section, section))
+		{
+			return slot;
+		}
+
+		i = (i + 1) & mask;
+	}
+}
+
+static bool SpanTable_Grow(SpanTable* table)
+{
+	SpanTable grown;
+	size_t i;
+
+	grown.capacity = table->capacity ? table->capacity * 2 : 64;
+	grown.count = table->count;
+	grown.generation = 1;
+	grown.slots = calloc(grown.capacity, sizeof(Slot));
+
+	if (!grown.slots)
+		return false;
+
+	for (i = 0; i < table->capacity; ++i)
+	{
+		const Slot* slot = &table->slots[i];
+
+		if (slot->generation == table->generation)
+		{
+			Slot* moved = SpanTable_Slot(&grown, slot->section, slot->key,
+				slot->hash);
+
+			*moved = *slot;
+			moved->generation = grown.generation;
+		}
+	}
+
+	free(table->slots);
+	*table = grown;
+
+	return true;
+}
+
+static const Slot* SpanTable_Find(const SpanTable* table, IniSpan section,
+	IniSpan key, uint32_t hash)
+{
+	const Slot* slot = NULL;
+
+	if (!table->count)
+		return NULL;
+
+	slot = SpanTable_Slot(table, section, key, hash);
+
+	return slot->generation == table->generation ? slot : NULL;
+}
+
+/*
+ * Adds a pair unless it is already there. Returns the slot holding the pair,
+ * with *added telling which happened, or NULL if memory ran out.
+ */
+static Slot* SpanTable_Add(SpanTable* table, IniSpan section, IniSpan key,
+	uint32_t hash, size_t value, bool* added)
+{
+	Slot* slot = NULL;
+
+	/* Kept at most half full. */
+	if ((table->count + 1) * 2 > table->capacity && !SpanTable_Grow(table))
+		return NULL;
+
+	slot = SpanTable_Slot(table, section, key, hash);
+	*added = slot->generation != table->generation;
+
+	if (*added)
+	{
+		slot->section = section;
+		slot->key = key;
+		slot->hash = hash;
+		slot->generation = table->generation;
+		slot->value = value;
+		table->count++;
+	}
+
+	return slot;
+}
+
+static void SpanTable_Clear(SpanTable* table)
+{
+	table->count = 0;
+
+	if (++table->generation == 0)
+	{
+		/* Wrapped around, old stamps could look current again. */
+		memset(table->slots, 0, table->capacity * sizeof(Slot));
+		table->generation = 1;
+	}
+}
+
+/* Schemas */
+
+typedef enum
+{
+	RuleType_Int = 0,
+	RuleType_Double,
+	RuleType_Bool,
+	RuleType_String
+} RuleType;
+
+static const char* const RuleTypeNames[] = { "int", "double", "bool", "string" };
+
+typedef struct
+{
+	RuleType type;
+
+	/* Longest string allowed, including the terminator. */
+	size_t size;
+} Rule;
+
+typedef struct
+{
+	IniFile* file;
+	Rule* rules;
+
+	/* Section names, and (section, key) pairs mapped to rules. */
+	SpanTable sections;
+	SpanTable keys;
+} Schema;
+
+/* Reads the "type[size]" at the start of a schema value. */
+static bool ParseRule(const char* value, Rule* rule)
+{
+	size_t length = 0;
+	size_t i;
+
+	while (value[length] && value[length] != ' ' && value[length] != '\t' &&
+		value[length] != DM_LEFT_BRACKET)
+	{
+		++length;
+	}
+
+	for (i = 0; i < sizeof(RuleTypeNames) / sizeof(RuleTypeNames[0]); ++i)
+	{
+		if (strlen(RuleTypeNames[i]) == length &&
+			strncmp(value, RuleTypeNames[i], length) == 0)
+		{
+			break;
+		}
+	}
+
+	if (i == sizeof(RuleTypeNames) / sizeof(RuleTypeNames[0]))
+		return false;
+
+	rule->type = (RuleType)i;
+	rule->size = 64;
+
+	if (value[length] == DM_LEFT_BRACKET)
+	{
+		char* end = NULL;
+		unsigned long size = strtoul(value + length + 1, &end, 10);
+
+		if (rule->type != RuleType_String || *end != DM_RIGHT_BRACKET ||
+			size < 1)
+		{
+			return false;
+		}
+
+		rule->size = (size_t)size;
+	}
+
+	return true;
+}
+
+static IniSpan MakeSpan(const char* text)
+{
+	IniSpan span;
+
+	span.data = text;
+	span.length = text ? strlen(text) : 0;
+
+	return span;
+}
+
+static bool OutOfMemory()
+{
+	fprintf(stderr, "inilint: %s\n", DM_INI_ERROR_MESSAGE_MALLOC_FAIL);
+
+	return false;
+}
+
+/* Loads a schema up front so the workers only ever read it. */
+static bool LoadSchema(const char* path, Schema* schema)
+{
+	size_t sectionCount = 0;
+	size_t itemCount = 0;
+	size_t s;
+	size_t used = 0;
+	bool added = false;
+
+	schema->file = IniFile_ReadFile(path);
+
+	if (!schema->file)
+	{
+		IniErrorHint* hint = IniFile_GetErrorHint();
+
+		fprintf(stderr, "inilint: could not read the schema %s: %s\n", path,
+			hint && hint->errorText ? hint->errorText : "unknown error");
+
+		return false;
+	}
+
+	sectionCount = IniFile_SectionCount(schema->file);
+	itemCount = IniSection_ItemCount(IniFile_GetSection(schema->file, NULL));
+
+	for (s = 0; s < sectionCount; ++s)
+		itemCount += IniSection_ItemCount(IniFile_SectionAt(schema->file, s));
+
+	schema->rules = malloc((itemCount ? itemCount : 1) * sizeof(Rule));
+
+	if (!schema->rules)
+		return OutOfMemory();
+
+	for (s = 0; s <= sectionCount; ++s)
+	{
+		IniSection* section = s ? IniFile_SectionAt(schema->file, s - 1) :
+			IniFile_GetSection(schema->file, NULL);
+		IniSpan name = MakeSpan(s ? section->name : NULL);
+		uint32_t sectionHash = __IniFile_HashSpan(name.data, name.length);
+		size_t i;
+
+		if (!SpanTable_Add(&schema->sections, name, name, sectionHash, 0,
+			&added))
+		{
+			return OutOfMemory();
+		}
+
+		for (i = 0; i < IniSection_ItemCount(section); ++i)
+		{
+			IniItem* item = IniSection_ItemAt(section, i);
+			const char* value = IniFile_GetItemValue(schema->file, item);
+			IniSpan key = MakeSpan(item->key);
+
+			if (!value || !ParseRule(value, &schema->rules[used]))
+			{
+				fprintf(stderr, "inilint: bad type for %s in the schema %s\n",
+					item->key, path);
+
+				return false;
+			}
+
+			if (!SpanTable_Add(&schema->keys, name, key,
+				SpanTable_Hash(sectionHash, key), used, &added))
+			{
+				return OutOfMemory();
+			}
+
+			used++;
+		}
+	}
+
+	return true;
+}
+
+static void FreeSchema(Schema* schema)
+{
+	free(schema->sections.slots);
+	free(schema->keys.slots);
+	free(schema->rules);
+	IniFile_Free(schema->file);
+}
+
+/* Checking a file */
+
+typedef struct
+{
+	const char* path;
+	const char* buffer;
+	const Schema* schema;
+	Report* report;
+
+	/* Keys seen so far, mapped to the line they were first set on. */
+	SpanTable* seen;
+
+	IniSpan section;
+	uint32_t sectionHash;
+
+	/* Whether the schema declares the current section. */
+	bool sectionKnown;
+
+	/* Moves forward through the buffer to turn offsets into lines. */
+	size_t cursor;
+	size_t line;
+	size_t lineStart;
+
+	bool failed;
+} Lint;
+
+static void Lint_Locate(Lint* lint, size_t offset, size_t* line,
+	size_t* column)
+{
+	/* Offsets only go backwards for a problem behind the last one. */
+	if (offset < lint->cursor)
+	{
+		lint->cursor = 0;
+		lint->line = 1;
+		lint->lineStart = 0;
+	}
+
+	while (lint->cursor < offset)
+	{
+		const char* newline = memchr(lint->buffer + lint->cursor, '\n',
+			offset - lint->cursor);
+
+		if (!newline)
+			break;
+
+		lint->line++;
+		lint->cursor = (size_t)(newline - lint->buffer) + 1;
+		lint->lineStart = lint->cursor;
+	}
+
+	lint->cursor = offset;
+
+	*line = lint->line;
+	*column = offset - lint->lineStart + 1;
+}
+
+static void Lint_Problem(Lint* lint, const char* at, const char* format, ...)
+{
+	size_t line = 0;
+	size_t column = 0;
+	va_list args;
+
+	Lint_Locate(lint, (size_t)(at - lint->buffer), &line, &column);
+
+	va_start(args, format);
+
+	if (!Report_Add(lint->report, "%s:%lu:%lu: ", lint->path,
+		(unsigned long)line, (unsigned long)column) ||
+		!Report_Append(lint->report, format, args) ||
+		!Report_Add(lint->report, "\n"))
+	{
+		lint->failed = true;
+	}
+
+	va_end(args);
+
+	lint->report->problems++;
+}
+
+static bool Lint_OnSection(void* user, IniSpan name)
+{
+	Lint* lint = (Lint*)user;
+
+	lint->section = name;
+	lint->sectionHash = __IniFile_HashSpan(name.data, name.length);
+
+	if (lint->schema)
+	{
+		lint->sectionKnown = SpanTable_Find(&lint->schema->sections, name, name,
+			lint->sectionHash) != NULL;
+
+		if (!lint->sectionKnown)
+		{
+			Lint_Problem(lint, name.data, "section [%.*s] is not in the schema",
+				(int)name.length, name.data);
+		}
+	}
+
+	return !lint->failed;
+}
+
+static void Lint_CheckValue(Lint* lint, IniSpan key, const IniValue* value,
+	const Rule* rule)
+{
+	long number = 0;
+	double real = 0;
+	bool flag = false;
+	bool fits = false;
+
+	switch (rule->type)
+	{
+	case RuleType_Int:
+		fits = IniValue_ToLong(value, &number);
+		break;
+	case RuleType_Double:
+		fits = IniValue_ToDouble(value, &real);
+		break;
+	case RuleType_Bool:
+		fits = IniValue_ToBool(value, &flag);
+		break;
+	case RuleType_String:
+		if (IniValue_Join(value, NULL) < rule->size)
+			return;
+
+		Lint_Problem(lint, key.data, "%.*s is longer than %lu bytes",
+			(int)key.length, key.data, (unsigned long)rule->size - 1);
+		return;
+	}
+
+	if (!fits)
+	{
+		Lint_Problem(lint, key.data, "%.*s is not a valid %s", (int)key.length,
+			key.data, RuleTypeNames[rule->type]);
+	}
+}
+
+static bool Lint_OnItem(void* user, IniSpan key, const IniValue* value)
+{
+	Lint* lint = (Lint*)user;
+	uint32_t hash = 0;
+	bool array = false;
+
+	/* Repeating "key[]" is how arrays are written. */
+	if (key.length > 2 && key.data[key.length - 2] == DM_LEFT_BRACKET &&
+		key.data[key.length - 1] == DM_RIGHT_BRACKET)
+	{
+		key.length -= 2;
+		array = true;
+	}
+
+	hash = SpanTable_Hash(lint->sectionHash, key);
+
+	if (!array)
+	{
+		size_t line = 0;
+		size_t column = 0;
+		bool added = false;
+		Slot* slot = NULL;
+
+		Lint_Locate(lint, (size_t)(key.data - lint->buffer), &line, &column);
+		slot = SpanTable_Add(lint->seen, lint->section, key, hash, line, &added);
+
+		if (!slot)
+		{
+			lint->failed = true;
+
+			return false;
+		}
+
+		if (!added)
+		{
+			Lint_Problem(lint, key.data, "%.*s is already set on line %lu",
+				(int)key.length, key.data, (unsigned long)slot->value);
+		}
+	}
+
+	if (lint->schema && lint->sectionKnown)
+	{
+		const Slot* rule = SpanTable_Find(&lint->schema->keys, lint->section,
+			key, hash);
+
+		if (!rule)
+		{
+			Lint_Problem(lint, key.data, "%.*s is not in the schema",
+				(int)key.length, key.data);
+		}
+		else
+		{
+			Lint_CheckValue(lint, key, value,
+				&lint->schema->rules[rule->value]);
+		}
+	}
+
+	return !lint->failed;
+}
+
+/* What each worker keeps between files. */
+typedef struct
+{
+	char* buffer;
+	size_t capacity;
+	SpanTable seen;
+} Scratch;
+
+static bool ReadWhole(const char* path, Scratch* scratch, size_t* length)
+{
+	FILE* fp = fopen(path, "rb");
+	size_t read = 0;
+
+	if (!fp)
+		return false;
+
+	*length = 0;
+
+	for (;;)
+	{
+		if (*length == scratch->capacity)
+		{
+			size_t capacity = scratch->capacity ? scratch->capacity * 2 : 65536;
+			char* buffer = realloc(scratch->buffer, capacity);
+
+			if (!buffer)
+			{
+				fclose(fp);
+
+				return false;
+			}
+
+			scratch->buffer = buffer;
+			scratch->capacity = capacity;
+		}
+
+		read = fread(scratch->buffer + *length, 1, scratch->capacity - *length,
+			fp);
+		*length += read;
+
+		if (read == 0)
+			break;
+	}
+
+	if (ferror(fp))
+	{
+		fclose(fp);
+
+		return false;
+	}
+
+	fclose(fp);
+
+	return true;
+}
+
+static void LintFile(const char* path, const Schema* schema, Scratch* scratch,
+	Report* report)
+{
+	IniHandler handler = { Lint_OnSection, Lint_OnItem };
+	IniErrorHint* hint = NULL;
+	Lint lint;
+	char* decoded = NULL;
+	size_t decodedLength = 0;
+	size_t length = 0;
+
+	if (!ReadWhole(path, scratch, &length))
+	{
+		Report_Add(report, "%s: could not be read\n", path);
+		report->problems++;
+
+		return;
+	}
+
+	/* UTF-16 is checked as UTF-8, as IniFile_ReadBuffer() reads it. */
+	if (!__IniFile_DecodeUtf16(scratch->buffer, length, NULL, &decoded,
+		&decodedLength))
+	{
+		Report_Add(report, "%s: %s\n", path,
+			IniFile_GetErrorHint()->errorText);
+		report->problems++;
+
+		return;
+	}
+
+	memset(&lint, 0, sizeof(lint));
+	lint.path = path;
+	lint.buffer = decoded ? decoded : scratch->buffer;
+	lint.schema = schema;
+	lint.report = report;
+	lint.seen = &scratch->seen;
+	lint.line = 1;
+	lint.sectionHash = __IniFile_HashSpan(NULL, 0);
+
+	if (schema)
+	{
+		lint.sectionKnown = SpanTable_Find(&schema->sections, lint.section,
+			lint.section, lint.sectionHash) != NULL;
+	}
+
+	SpanTable_Clear(lint.seen);
+
+	if (decoded)
+		length = decodedLength;
+
+	if (IniFile_Parse(lint.buffer, length, NULL, &handler, &lint))
+	{
+		__IniAllocator_Free(NULL, decoded);
+
+		return;
+	}
+
+	hint = IniFile_GetErrorHint();
+
+	if (lint.failed || !hint)
+	{
+		Report_Add(report, "%s: %s\n", path, DM_INI_ERROR_MESSAGE_MALLOC_FAIL);
+		report->problems++;
+	}
+	else if (hint->errorOffset == DM_INI_NO_OFFSET)
+	{
+		Report_Add(report, "%s: %s\n", path, hint->errorText);
+		report->problems++;
+	}
+	else
+	{
+		Lint_Problem(&lint, lint.buffer + hint->errorOffset, "%s",
+			hint->errorText);
+	}
+
+	__IniAllocator_Free(NULL, decoded);
+}
+
+/* Finding files */
+
+typedef struct
+{
+	char** paths;
+	size_t count;
+	size_t capacity;
+} PathList;
+
+static bool PathList_Add(PathList* list, const char* directory,
+	const char* name)
+{
+	size_t length = strlen(directory);
+	char* path = malloc(length + strlen(name) + 2);
+
+	if (!path)
+		return false;
+
+	if (list->count == list->capacity)
+	{
+		size_t capacity = list->capacity ? list->capacity * 2 : 256;
+		char** paths = realloc(list->paths, capacity * sizeof(char*));
+
+		if (!paths)
+		{
+			free(path);
+
+			return false;
+		}
+
+		list->paths = paths;
+		list->capacity = capacity;
+	}
+
+	strcpy(path, directory);
+
+	if (*name)
+	{
+		if (length && path[length - 1] != INILINT_PATH_SEPARATOR)
+			path[length++] = INILINT_PATH_SEPARATOR;
+
+		strcpy(path + length, name);
+	}
+
+	list->paths[list->count++] = path;
+
+	return true;
+}
+
+static bool IsIniFile(const char* name)
+{
+	const char* dot = strrchr(name, '.');
+
+	return dot && (strcmp(dot, ".ini") == 0 || strcmp(dot, ".conf") == 0);
+}
+
+static int ComparePaths(const void* a, const void* b)
+{
+	return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+/* Adds the ini files under directory, or directory itself if it is a file. */
+static bool FindFiles(PathList* list, const char* directory, bool top)
+{
+	size_t first = list->count;
+
+#ifdef _WIN32
+	WIN32_FIND_DATAA found;
+	HANDLE search = INVALID_HANDLE_VALUE;
+	DWORD attributes = GetFileAttributesA(directory);
+	char* pattern = NULL;
+
+	if (attributes == INVALID_FILE_ATTRIBUTES)
+		return false;
+
+	if (!(attributes & FILE_ATTRIBUTE_DIRECTORY))
+		return PathList_Add(list, directory, "");
+
+	if (!PathList_Add(list, directory, "*"))
+		return false;
+
+	pattern = list->paths[--list->count];
+	search = FindFirstFileA(pattern, &found);
+	free(pattern);
+
+	if (search == INVALID_HANDLE_VALUE)
+		return true;
+
+	do
+	{
+		if (strcmp(found.cFileName, ".") == 0 ||
+			strcmp(found.cFileName, "..") == 0)
+		{
+			continue;
+		}
+
+		if (found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+		{
+			/* Junctions could lead round in circles. */
+			if (found.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)
+				continue;
+
+			if (!PathList_Add(list, directory, found.cFileName))
+				return false;
+
+			pattern = list->paths[--list->count];
+
+			if (!FindFiles(list, pattern, false))
+			{
+				free(pattern);
+				FindClose(search);
+
+				return false;
+			}
+
+			free(pattern);
+		}
+		else if (IsIniFile(found.cFileName) &&
+			!PathList_Add(list, directory, found.cFileName))
+		{
+			FindClose(search);
+
+			return false;
+		}
+	} while (FindNextFileA(search, &found));
+
+	FindClose(search);
+#else
+	struct stat status;
+	struct dirent* entry = NULL;
+	DIR* dir = NULL;
+
+	if (stat(directory, &status) != 0)
+		return !top;
+
+	if (!S_ISDIR(status.st_mode))
+		return PathList_Add(list, directory, "");
+
+	dir = opendir(directory);
+
+	if (!dir)
+		return !top;
+
+	while ((entry = readdir(dir)) != NULL)
+	{
+		char* path = NULL;
+		bool keep = false;
+
+		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+			continue;
+
+		if (!PathList_Add(list, directory, entry->d_name))
+		{
+			closedir(dir);
+
+			return false;
+		}
+
+		path = list->paths[list->count - 1];
+
+		/* Links to directories could lead round in circles. */
+		if (lstat(path, &status) == 0 && S_ISDIR(status.st_mode))
+		{
+			list->count--;
+
+			if (!FindFiles(list, path, false))
+			{
+				free(path);
+				closedir(dir);
+
+				return false;
+			}
+
+			free(path);
+
+			continue;
+		}
+
+		keep = IsIniFile(entry->d_name) && stat(path, &status) == 0 &&
+			S_ISREG(status.st_mode);
+
+		if (!keep)
+		{
+			list->count--;
+			free(path);
+		}
+	}
+
+	closedir(dir);
+#endif
+
+	/* Directory order is arbitrary, so sort to keep the output stable. */
+	if (top)
+	{
+		qsort(list->paths + first, list->count - first, sizeof(char*),
+			ComparePaths);
+	}
+
+	return true;
+}
+
+/* Workers */
+
+typedef struct
+{
+	const PathList* files;
+	const Schema* schema;
+	Report* reports;
+
+	/* Index of the next file to hand out. */
+	volatile size_t next;
+} Pool;
+
+static size_t Pool_Take(Pool* pool)
+{
+#ifdef _WIN32
+#ifdef _WIN64
+	return (size_t)InterlockedExchangeAdd64((volatile LONG64*)&pool->next, 1);
+#else
+	return (size_t)InterlockedExchangeAdd((volatile LONG*)&pool->next, 1);
+#endif
+#else
+	return __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED);
+#endif
+}
+
+static void RunWorker(Pool* pool)
+{
+	Scratch scratch;
+	size_t i;
+
+	memset(&scratch, 0, sizeof(scratch));
+
+	/* Small files dominate, so taking them one at a time balances well. */
+	while ((i = Pool_Take(pool)) < pool->files->count)
+	{
+		LintFile(pool->files->paths[i], pool->schema, &scratch,
+			&pool->reports[i]);
+	}
+
+	free(scratch.buffer);
+	free(scratch.seen.slots);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI Worker(LPVOID user)
+{
+	RunWorker((Pool*)user);
+
+	return 0;
+}
+#else
+static void* Worker(void* user)
+{
+	RunWorker((Pool*)user);
+
+	return NULL;
+}
+#endif
+
+static size_t CountCores()
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+
+	GetSystemInfo(&info);
+
+	return info.dwNumberOfProcessors ? info.dwNumberOfProcessors : 1;
+#else
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return cores > 0 ? (size_t)cores : 1;
+#endif
+}
+
+/* Runs the pool on threadCount threads, the calling one included. */
+static bool RunPool(Pool* pool, size_t threadCount)
+{
+	size_t started = 0;
+	size_t i;
+
+#ifdef _WIN32
+	HANDLE* threads = calloc(threadCount, sizeof(HANDLE));
+
+	if (!threads)
+		return false;
+
+	for (; started + 1 < threadCount; ++started)
+	{
+		threads[started] = CreateThread(NULL, 0, Worker, pool, 0, NULL);
+
+		if (!threads[started])
+			break;
+	}
+
+	/* Whatever threads could not be started, the work still gets done. */
+	RunWorker(pool);
+
+	for (i = 0; i < started; ++i)
+	{
+		WaitForSingleObject(threads[i], INFINITE);
+		CloseHandle(threads[i]);
+	}
+#else
+	pthread_t* threads = calloc(threadCount, sizeof(pthread_t));
+
+	if (!threads)
+		return false;
+
+	for (; started + 1 < threadCount; ++started)
+	{
+		if (pthread_create(&threads[started], NULL, Worker, pool) != 0)
+			break;
+	}
+
+	/* Whatever threads could not be started, the work still gets done. */
+	RunWorker(pool);
+
+	for (i = 0; i < started; ++i)
+		pthread_join(threads[i], NULL);
+#endif
+
+	free(threads);
+
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	PathList files;
+	Schema schema;
+	Pool pool;
+	const char* schemaPath = NULL;
+	size_t threadCount = 0;
+	size_t problems = 0;
+	size_t dirty = 0;
+	int result = INILINT_CLEAN;
+	int arg = 1;
+	size_t i;
+
+	memset(&files, 0, sizeof(files));
+	memset(&schema, 0, sizeof(schema));
+	memset(&pool, 0, sizeof(pool));
+
+	for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2)
+	{
+		if (strcmp(argv[arg], "-j") == 0)
+			threadCount = strtoul(argv[arg + 1], NULL, 10);
+		else if (strcmp(argv[arg], "-s") == 0)
+			schemaPath = argv[arg + 1];
+		else
+			break;
+	}
+
+	if (arg >= argc || argv[arg][0] == '-')
+	{
+		fprintf(stderr,
+			"usage: inilint [-j threads] [-s schema.ini] <path>...\n");
+
+		return INILINT_ERROR;
+	}
+
+	if (schemaPath && !LoadSchema(schemaPath, &schema))
+	{
+		FreeSchema(&schema);
+
+		return INILINT_ERROR;
+	}
+
+	for (; arg < argc; ++arg)
+	{
+		if (!FindFiles(&files, argv[arg], true))
+		{
+			fprintf(stderr, "inilint: could not search %s\n", argv[arg]);
+			result = INILINT_ERROR;
+
+			break;
+		}
+	}
+
+	if (result == INILINT_CLEAN && files.count)
+	{
+		pool.files = &files;
+		pool.schema = schemaPath ? &schema : NULL;
+		pool.reports = calloc(files.count, sizeof(Report));
+
+		if (!threadCount)
+			threadCount = CountCores();
+
+		if (threadCount > files.count)
+			threadCount = files.count;
+
+		if (!pool.reports || !RunPool(&pool, threadCount))
+		{
+			OutOfMemory();
+			result = INILINT_ERROR;
+		}
+	}
+
+	for (i = 0; i < files.count; ++i)
+	{
+		if (pool.reports && pool.reports[i].problems)
+		{
+			fwrite(pool.reports[i].text, 1, pool.reports[i].length, stdout);
+			problems += pool.reports[i].problems;
+			dirty++;
+		}
+
+		if (pool.reports)
+			free(pool.reports[i].text);
+
+		free(files.paths[i]);
+	}
+
+	if (result == INILINT_CLEAN && problems)
+	{
+		fprintf(stderr, "inilint: %lu problems in %lu of %lu files\n",
+			(unsigned long)problems, (unsigned long)dirty,
+			(unsigned long)files.count);
+
+		result = INILINT_PROBLEMS;
+	}
+
+	free(pool.reports);
+	free(files.paths);
+	FreeSchema(&schema);
+
+	return result;
+}
@@ -0,0 +1,36 @@
+#!/bin/sh
+#
+# Runs inilint on the tree next to this script and checks what it prints.
+#
+# Usage: run.sh <path to inilint>
+
+inilint=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+output=$(mktemp)
+failed=0
+
+cd "$(dirname "$0")" || exit 1
+
+# A duplicate key, values that do not fit the schema, an unclosed block
+# comment and a duplicate key in UTF-16, each reported as path:line:col.
+# notes.txt is not looked at.
+"$inilint" -j 2 -s schema.ini tree >"$output" 2>/dev/null
+status=$?
+
+if [ "$status" -ne 1 ] || ! diff -u expected.txt "$output"; then
+	echo "FAIL: inilint -s schema.ini tree exited with $status"
+	failed=1
+fi
+
+if ! "$inilint" tree/clean.ini >"$output" 2>&1 || [ -s "$output" ]; then
+	echo "FAIL: inilint tree/clean.ini"
+	cat "$output"
+	failed=1
+fi
+
+rm -f "$output"
+
+if [ "$failed" -ne 0 ]; then
+	exit 1
+fi
+
+echo "inilint: OK"
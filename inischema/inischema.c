@@ -0,0 +1,792 @@
+/**
+ * inischema.c - Generates a struct and a bind function from an ini schema.
+ *
+ * CIniFile: C implementation of reading ini configuration files.
+ * An open source project of HYPEWORKS.
+ *
+ * Copyright (C) 2017-2021 HYPEWORKS Ltd Co.
+ */
+
+/*
+ * This software library is open source and licensed under the MIT License.
+ *
+ * Read LICENSE for the full license text.
+ */
+
+/*
+ * Usage: inischema <schema.ini> <output> <TypeName>
+ *
+ * Writes <output>.h and <output>.c. The schema is itself an ini file whose
+ * items are the settings, each with a type and an optional default:
+ *
+ *     port = int 8080
+ *     [server]
+ *     host = string[128] localhost
+ *     ratio = double 0.5
+ *     verbose = bool false
+ *
+ * A plain "string" holds up to 63 bytes. The generated TypeName_Bind()
+ * reads ini text into a TypeName in a single IniFile_Parse() pass. Keys
+ * are matched with a switch over hashes worked out here, so no lookup
+ * table is built or probed at run time.
+ */
+
+#include "../CIniFile/IniFile.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Longest identifier made from a section name or key.
+#define SCHEMA_MAX_IDENTIFIER 128
+
+// Size of a "string" field with no size given.
+#define SCHEMA_DEFAULT_STRING_SIZE 64
+
+typedef enum
+{
+	FieldType_Long = 0,
+	FieldType_Double,
+	FieldType_Bool,
+	FieldType_String
+} FieldType;
+
+typedef struct
+{
+	IniItem* item;
+	char identifier[SCHEMA_MAX_IDENTIFIER];
+	FieldType type;
+
+	/* Size of a string field including its terminator. */
+	size_t size;
+
+	/* Default value as written in the schema, NULL for none. */
+	const char* defaultValue;
+} Field;
+
+typedef struct
+{
+	/* Name as written in the schema, "" for the global settings. */
+	const char* name;
+	char identifier[SCHEMA_MAX_IDENTIFIER];
+
+	Field* fields;
+	size_t fieldCount;
+
+	/* Number the bind function uses for this section. */
+	int number;
+} Group;
+
+typedef struct
+{
+	Group* groups;
+	size_t groupCount;
+} Schema;
+
+static const char* const Keywords[] =
+{
+	"auto", "bool", "break", "case", "char", "const", "continue", "default",
+	"do", "double", "else", "enum", "extern", "float", "for", "goto", "if",
+	"inline", "int", "long", "register", "restrict", "return", "short",
+	"signed", "sizeof", "static", "struct", "switch", "typedef", "union",
+	"unsigned", "void", "volatile", "while"
+};
+
+static const char* const TypeNames[] = { "long", "double", "bool", "char" };
+
+static const char* const Converters[] =
+{
+	"IniValue_ToLong", "IniValue_ToDouble", "IniValue_ToBool",
+	"IniValue_ToString"
+};
+
+static int Fail(const char* format, const char* detail)
+{
+	fputs("inischema: ", stderr);
+	fprintf(stderr, format, detail);
+	fputc('\n', stderr);
+
+	return EXIT_FAILURE;
+}
+
+/* Turns a section name or key into a C identifier. */
+static bool MakeIdentifier(const char* text, char* identifier)
+{
+	size_t length = strlen(text);
+	size_t used = 0;
+	size_t i;
+
+	if (!length || length + 2 >= SCHEMA_MAX_IDENTIFIER)
+		return false;
+
+	if (isdigit((unsigned char)text[0]))
+		identifier[used++] = '_';
+
+	for (i = 0; i < length; ++i)
+	{
+		unsigned char c = (unsigned char)text[i];
+
+		identifier[used++] = isalnum(c) ? (char)c : '_';
+	}
+
+	identifier[used] = '\0';
+
+	for (i = 0; i < sizeof(Keywords) / sizeof(Keywords[0]); ++i)
+	{
+		if (strcmp(identifier, Keywords[i]) == 0)
+		{
+			identifier[used++] = '_';
+			identifier[used] = '\0';
+
+			break;
+		}
+	}
+
+	return true;
+}
+
+static bool IsValidDefault(const Field* field)
+{
+	const char* text = field->defaultValue;
+	char* end = NULL;
+
+	switch (field->type)
+	{
+	case FieldType_Long:
+		errno = 0;
+		strtol(text, &end, 10);
+		return errno != ERANGE && end != text && *end == '\0';
+	case FieldType_Double:
+		strtod(text, &end);
+		return end != text && *end == '\0';
+	case FieldType_Bool:
+		return strcmp(text, "true") == 0 || strcmp(text, "false") == 0 ||
+			strcmp(text, "yes") == 0 || strcmp(text, "no") == 0 ||
+			strcmp(text, "on") == 0 || strcmp(text, "off") == 0 ||
+			strcmp(text, "1") == 0 || strcmp(text, "0") == 0;
+	case FieldType_String:
+		return strlen(text) < field->size;
+	}
+
+	return false;
+}
+
+/* Reads "type[size] default" from a schema value. */
+static bool ParseField(Field* field, const char* value)
+{
+	static const char* const names[] = { "int", "double", "bool", "string" };
+	size_t length = 0;
+	size_t i;
+
+	while (value[length] && value[length] != ' ' && value[length] != '\t' &&
+		value[length] != DM_LEFT_BRACKET)
+	{
+		++length;
+	}
+
+	for (i = 0; i < sizeof(names) / sizeof(names[0]); ++i)
+	{
+		if (strlen(names[i]) == length && strncmp(value, names[i], length) == 0)
+			break;
+	}
+
+	if (i == sizeof(names) / sizeof(names[0]))
+		return false;
+
+	field->type = (FieldType)i;
+	field->size = field->type == FieldType_String ?
+		SCHEMA_DEFAULT_STRING_SIZE : 0;
+	value += length;
+
+	if (*value == DM_LEFT_BRACKET)
+	{
+		char* end = NULL;
+		unsigned long size = strtoul(value + 1, &end, 10);
+
+		if (field->type != FieldType_String || end == value + 1 ||
+			*end != DM_RIGHT_BRACKET || size < 1)
+		{
+			return false;
+		}
+
+		field->size = (size_t)size;
+		value = end + 1;
+	}
+
+	while (*value == ' ' || *value == '\t')
+		++value;
+
+	field->defaultValue = *value ? value : NULL;
+
+	return !field->defaultValue || IsValidDefault(field);
+}
+
+static int LoadSchema(IniFile* file, Schema* schema)
+{
+	size_t sectionCount = IniFile_SectionCount(file);
+	size_t s;
+
+	schema->groups = calloc(sectionCount + 1, sizeof(Group));
+
+	if (!schema->groups)
+		return Fail("%s", DM_INI_ERROR_MESSAGE_MALLOC_FAIL);
+
+	for (s = 0; s <= sectionCount; ++s)
+	{
+		IniSection* section = s ? IniFile_SectionAt(file, s - 1) :
+			IniFile_GetSection(file, NULL);
+		Group* group = &schema->groups[schema->groupCount];
+		size_t itemCount = IniSection_ItemCount(section);
+		size_t i;
+		size_t j;
+
+		/* A section without settings would make an empty struct. */
+		if (!itemCount)
+			continue;
+
+		group->name = s ? section->name : "";
+		group->number = (int)s;
+
+		if (s && !MakeIdentifier(group->name, group->identifier))
+			return Fail("section [%s] can not be made into a name", group->name);
+
+		/* Sections become members next to the global settings. */
+		for (j = 0; j < schema->groupCount && s; ++j)
+		{
+			const Group* other = &schema->groups[j];
+			size_t k;
+
+			if (other->number &&
+				strcmp(other->identifier, group->identifier) == 0)
+			{
+				return Fail("section [%s] clashes with another", group->name);
+			}
+
+			for (k = 0; k < other->fieldCount && !other->number; ++k)
+			{
+				if (strcmp(other->fields[k].identifier, group->identifier) == 0)
+					return Fail("section [%s] clashes with a setting", group->name);
+			}
+		}
+
+		group->fields = calloc(itemCount, sizeof(Field));
+
+		if (!group->fields)
+			return Fail("%s", DM_INI_ERROR_MESSAGE_MALLOC_FAIL);
+
+		schema->groupCount++;
+
+		for (i = 0; i < itemCount; ++i)
+		{
+			IniItem* item = IniSection_ItemAt(section, i);
+			Field* field = &group->fields[group->fieldCount];
+			const char* value = IniFile_GetItemValue(file, item);
+
+			field->item = item;
+
+			if (!value || !ParseField(field, value))
+				return Fail("bad type or default for %s", item->key);
+
+			if (!MakeIdentifier(item->key, field->identifier))
+				return Fail("%s can not be made into a name", item->key);
+
+			for (j = 0; j < group->fieldCount; ++j)
+			{
+				if (strcmp(group->fields[j].identifier, field->identifier) == 0)
+					return Fail("%s is declared twice", item->key);
+			}
+
+			group->fieldCount++;
+		}
+	}
+
+	if (!schema->groupCount)
+		return Fail("%s declares no settings", "the schema");
+
+	return EXIT_SUCCESS;
+}
+
+static void WriteString(FILE* fp, const char* text)
+{
+	fputc('"', fp);
+
+	for (; *text; ++text)
+	{
+		unsigned char c = (unsigned char)*text;
+
+		if (c == '"' || c == '\\' || c == '?')
+			fprintf(fp, "\\%c", c);
+		else if (c < 0x20 || c >= 0x7f)
+			fprintf(fp, "\\%03o", c);
+		else
+			fputc(c, fp);
+	}
+
+	fputc('"', fp);
+}
+
+/*
+ * Writes a double default as a C constant. Plain decimals are written as
+ * given so nothing is lost to rounding. Anything else strtod() reads, such
+ * as hex, inf, nan or a decimal out of range, is written from its value.
+ */
+static void WriteDouble(FILE* fp, const char* text)
+{
+	double value = 0;
+
+	errno = 0;
+	value = strtod(text, NULL);
+
+	if (errno != ERANGE && text[strspn(text, "+-0123456789.eE")] == '\0')
+		fprintf(fp, "%s%s", text, strpbrk(text, ".eE") ? "" : ".0");
+	else if (isnan(value))
+		fputs("NAN", fp);
+	else if (isinf(value))
+		fputs(value < 0 ? "-HUGE_VAL" : "HUGE_VAL", fp);
+	else
+		fprintf(fp, "%a", value);
+}
+
+/* Writes the path to a field from the config pointer, like "server.port". */
+static void WriteMember(FILE* fp, const Group* group, const Field* field)
+{
+	if (group->number)
+		fprintf(fp, "config->%s.%s", group->identifier, field->identifier);
+	else
+		fprintf(fp, "config->%s", field->identifier);
+}
+
+static void WriteFieldDeclaration(FILE* fp, const Field* field,
+	const char* indent)
+{
+	fprintf(fp, "%s%s %s", indent, TypeNames[field->type], field->identifier);
+
+	if (field->type == FieldType_String)
+		fprintf(fp, "[%lu]", (unsigned long)field->size);
+
+	fputs(";\n", fp);
+}
+
+static void WriteHeader(FILE* fp, const Schema* schema, const char* schemaPath,
+	const char* typeName)
+{
+	size_t g;
+	size_t i;
+
+	fprintf(fp, "/* Generated by inischema from %s, do not edit. */\n\n",
+		schemaPath);
+	fprintf(fp, "#ifndef %s_GENERATED_H_\n", typeName);
+	fprintf(fp, "#define %s_GENERATED_H_\n\n", typeName);
+	fputs("#include \"IniFile.h\"\n\n", fp);
+	fputs("#ifdef __cplusplus\nextern \"C\" {\n#endif\n\n", fp);
+
+	fputs("typedef struct\n{\n", fp);
+
+	for (g = 0; g < schema->groupCount; ++g)
+	{
+		const Group* group = &schema->groups[g];
+
+		if (group->number)
+		{
+			fputs("\tstruct\n\t{\n", fp);
+
+			for (i = 0; i < group->fieldCount; ++i)
+				WriteFieldDeclaration(fp, &group->fields[i], "\t\t");
+
+			fprintf(fp, "\t} %s;\n", group->identifier);
+		}
+		else
+		{
+			for (i = 0; i < group->fieldCount; ++i)
+				WriteFieldDeclaration(fp, &group->fields[i], "\t");
+		}
+	}
+
+	fprintf(fp, "} %s;\n\n", typeName);
+
+	fputs("/**\n * @brief Fills in the defaults from the schema, zero for settings "
+		"without one.\n */\n", fp);
+	fprintf(fp, "void %s_SetDefaults(%s* config);\n\n", typeName, typeName);
+
+	fputs("/**\n * @brief Reads ini text into config in a single pass.\n *\n"
+		" * Settings the text leaves out keep their current values, so several "
+		"files\n * can be layered. Sections and keys not in the schema are "
+		"ignored.\n *\n"
+		" * @return Returns false on a syntax error or a value that does not fit "
+		"its\n * setting, with the reason in IniFile_GetErrorHint().\n */\n", fp);
+	fprintf(fp, "bool %s_Bind(%s* config, const char* buffer, size_t length,\n"
+		"\tconst IniOptions* options);\n\n", typeName, typeName);
+
+	fputs("#ifdef __cplusplus\n}\n#endif\n\n", fp);
+	fprintf(fp, "#endif // %s_GENERATED_H_\n", typeName);
+}
+
+/* Writes the switch that matches a name against one group of names. */
+static void WriteNameSwitch(FILE* fp, const char* indent, const char* variable,
+	const char** names, const void* targets, size_t stride, size_t count,
+	void (*writeMatch)(FILE*, const char*, const void*, const void*),
+	const void* context)
+{
+	size_t i;
+	size_t j;
+
+	fprintf(fp, "%sswitch (__IniFile_HashSpan(%s.data, %s.length))\n%s{\n",
+		indent, variable, variable, indent);
+
+	for (i = 0; i < count; ++i)
+	{
+		uint32_t hash = __IniFile_HashSpan(names[i], strlen(names[i]));
+		bool seen = false;
+
+		/* Names that share a hash share a case. */
+		for (j = 0; j < i && !seen; ++j)
+			seen = __IniFile_HashSpan(names[j], strlen(names[j])) == hash;
+
+		if (seen)
+			continue;
+
+		fprintf(fp, "%scase 0x%08lXu:\n", indent, (unsigned long)hash);
+
+		for (j = i; j < count; ++j)
+		{
+			size_t length = strlen(names[j]);
+
+			if (__IniFile_HashSpan(names[j], length) != hash)
+				continue;
+
+			fprintf(fp, "%s\tif (%s.length == %lu && memcmp(%s.data, ", indent,
+				variable, (unsigned long)length, variable);
+			WriteString(fp, names[j]);
+			fprintf(fp, ", %lu) == 0)\n", (unsigned long)length);
+			writeMatch(fp, indent, (const char*)targets + j * stride, context);
+		}
+
+		fprintf(fp, "%s\tbreak;\n", indent);
+	}
+
+	fprintf(fp, "%s}\n", indent);
+}
+
+static void WriteSectionMatch(FILE* fp, const char* indent,
+	const void* target, const void* context)
+{
+	const Group* group = (const Group*)target;
+
+	(void)context;
+
+	fprintf(fp, "%s\t\tbinder->section = %d;\n", indent, group->number);
+}
+
+static void WriteFieldMatch(FILE* fp, const char* indent, const void* target,
+	const void* context)
+{
+	const Field* field = (const Field*)target;
+	const Group* group = (const Group*)context;
+
+	fprintf(fp, "%s\t\treturn %s(value, %s", indent, Converters[field->type],
+		field->type == FieldType_String ? "" : "&");
+	WriteMember(fp, group, field);
+
+	if (field->type == FieldType_String)
+	{
+		fprintf(fp, ",\n%s\t\t\tsizeof(", indent);
+		WriteMember(fp, group, field);
+		fputc(')', fp);
+	}
+
+	fputs(");\n", fp);
+}
+
+static int WriteSource(FILE* fp, const Schema* schema, const char* schemaPath,
+	const char* headerName, const char* typeName)
+{
+	const char** names = NULL;
+	size_t most = schema->groupCount;
+	size_t g;
+	size_t i;
+
+	for (g = 0; g < schema->groupCount; ++g)
+	{
+		if (schema->groups[g].fieldCount > most)
+			most = schema->groups[g].fieldCount;
+	}
+
+	names = malloc(most * sizeof(const char*));
+
+	if (!names)
+		return Fail("%s", DM_INI_ERROR_MESSAGE_MALLOC_FAIL);
+
+	fprintf(fp, "/* Generated by inischema from %s, do not edit. */\n\n",
+		schemaPath);
+	fprintf(fp, "#include \"%s\"\n\n", headerName);
+	fputs("#include <math.h>\n#include <string.h>\n\n", fp);
+
+	fprintf(fp, "typedef struct\n{\n\t%s* config;\n\n"
+		"\t/* Section being read, -1 for one that is not in the schema. */\n"
+		"\tint section;\n} %s_Binder;\n\n", typeName, typeName);
+
+	/* Defaults */
+	fprintf(fp, "void %s_SetDefaults(%s* config)\n{\n", typeName, typeName);
+	fprintf(fp, "\tmemset(config, 0, sizeof(%s));\n", typeName);
+
+	for (g = 0; g < schema->groupCount; ++g)
+	{
+		const Group* group = &schema->groups[g];
+
+		for (i = 0; i < group->fieldCount; ++i)
+		{
+			const Field* field = &group->fields[i];
+			const char* text = field->defaultValue;
+
+			if (!text)
+				continue;
+
+			if (field->type == FieldType_String)
+			{
+				fputs("\tmemcpy(", fp);
+				WriteMember(fp, group, field);
+				fputs(", ", fp);
+				WriteString(fp, text);
+				fprintf(fp, ", %lu);\n", (unsigned long)strlen(text) + 1);
+
+				continue;
+			}
+
+			fputc('\t', fp);
+			WriteMember(fp, group, field);
+
+			if (field->type == FieldType_Bool)
+			{
+				bool value = strcmp(text, "true") == 0 || strcmp(text, "yes") == 0 ||
+					strcmp(text, "on") == 0 || strcmp(text, "1") == 0;
+
+				fprintf(fp, " = %s;\n", value ? "true" : "false");
+			}
+			else if (field->type == FieldType_Long)
+			{
+				long value = strtol(text, NULL, 10);
+
+				/* The literal for LONG_MIN's magnitude does not fit a long. */
+				if (value == LONG_MIN)
+					fprintf(fp, " = (%ldL - 1);\n", value + 1);
+				else
+					fprintf(fp, " = %ldL;\n", value);
+			}
+			else
+			{
+				fputs(" = ", fp);
+				WriteDouble(fp, text);
+				fputs(";\n", fp);
+			}
+		}
+	}
+
+	fputs("}\n\n", fp);
+
+	/* Sections */
+	fprintf(fp, "static bool %s_OnSection(void* user, IniSpan name)\n{\n",
+		typeName);
+	fprintf(fp, "\t%s_Binder* binder = (%s_Binder*)user;\n\n", typeName,
+		typeName);
+	fputs("\tbinder->section = -1;\n\n", fp);
+
+	{
+		const Group* sections = schema->groups;
+		size_t count = schema->groupCount;
+
+		/* The global settings are never named by a section declaration. */
+		if (count && !sections[0].number)
+		{
+			sections++;
+			count--;
+		}
+
+		for (i = 0; i < count; ++i)
+			names[i] = sections[i].name;
+
+		if (count)
+		{
+			WriteNameSwitch(fp, "\t", "name", names, sections, sizeof(Group),
+				count, WriteSectionMatch, NULL);
+			fputc('\n', fp);
+		}
+	}
+
+	fputs("\treturn true;\n}\n\n", fp);
+
+	/* Items */
+	fprintf(fp, "static bool %s_OnItem(void* user, IniSpan key,\n"
+		"\tconst IniValue* value)\n{\n", typeName);
+	fprintf(fp, "\t%s_Binder* binder = (%s_Binder*)user;\n", typeName,
+		typeName);
+	fprintf(fp, "\t%s* config = binder->config;\n\n", typeName);
+	fputs("\tswitch (binder->section)\n\t{\n", fp);
+
+	for (g = 0; g < schema->groupCount; ++g)
+	{
+		const Group* group = &schema->groups[g];
+
+		for (i = 0; i < group->fieldCount; ++i)
+			names[i] = group->fields[i].item->key;
+
+		fprintf(fp, "\tcase %d:\n", group->number);
+		WriteNameSwitch(fp, "\t\t", "key", names, group->fields, sizeof(Field),
+			group->fieldCount, WriteFieldMatch, group);
+		fputs("\t\tbreak;\n", fp);
+	}
+
+	fputs("\t}\n\n\treturn true;\n}\n\n", fp);
+
+	/* Bind */
+	fprintf(fp, "bool %s_Bind(%s* config, const char* buffer, size_t length,\n"
+		"\tconst IniOptions* options)\n{\n", typeName, typeName);
+	fprintf(fp, "\t%s_Binder binder;\n\tIniHandler handler;\n\n", typeName);
+	fputs("\tbinder.config = config;\n\tbinder.section = 0;\n\n", fp);
+	fprintf(fp, "\thandler.onSection = %s_OnSection;\n", typeName);
+	fprintf(fp, "\thandler.onItem = %s_OnItem;\n\n", typeName);
+	fputs("\treturn IniFile_Parse(buffer, length, options, &handler, "
+		"&binder);\n}\n", fp);
+
+	free(names);
+
+	return EXIT_SUCCESS;
+}
+
+static void FreeSchema(Schema* schema)
+{
+	size_t g;
+
+	for (g = 0; g < schema->groupCount; ++g)
+		free(schema->groups[g].fields);
+
+	free(schema->groups);
+}
+
+static bool IsTypeName(const char* text)
+{
+	if (!*text || isdigit((unsigned char)*text))
+		return false;
+
+	for (; *text; ++text)
+	{
+		if (!isalnum((unsigned char)*text) && *text != '_')
+			return false;
+	}
+
+	return true;
+}
+
+/* Joins base and extension into a new string. */
+static char* MakePath(const char* base, const char* extension)
+{
+	char* path = malloc(strlen(base) + strlen(extension) + 1);
+
+	if (path)
+	{
+		strcpy(path, base);
+		strcat(path, extension);
+	}
+
+	return path;
+}
+
+static const char* FileName(const char* path)
+{
+	const char* slash = strrchr(path, '/');
+	const char* backslash = strrchr(path, '\\');
+
+	if (backslash > slash)
+		slash = backslash;
+
+	return slash ? slash + 1 : path;
+}
+
+int main(int argc, char** argv)
+{
+	IniFile* file = NULL;
+	Schema schema;
+	char* headerPath = NULL;
+	char* sourcePath = NULL;
+	FILE* fp = NULL;
+	int result = EXIT_SUCCESS;
+
+	if (argc != 4)
+	{
+		fprintf(stderr, "usage: inischema <schema.ini> <output> <TypeName>\n");
+
+		return EXIT_FAILURE;
+	}
+
+	if (!IsTypeName(argv[3]))
+		return Fail("%s is not a valid type name", argv[3]);
+
+	memset(&schema, 0, sizeof(schema));
+
+	file = IniFile_ReadFile(argv[1]);
+
+	if (!file)
+	{
+		IniErrorHint* hint = IniFile_GetErrorHint();
+
+		return Fail("could not read the schema: %s", hint && hint->errorText ?
+			hint->errorText : argv[1]);
+	}
+
+	result = LoadSchema(file, &schema);
+
+	if (result == EXIT_SUCCESS)
+	{
+		headerPath = MakePath(argv[2], ".h");
+		sourcePath = MakePath(argv[2], ".c");
+
+		if (!headerPath || !sourcePath)
+			result = Fail("%s", DM_INI_ERROR_MESSAGE_MALLOC_FAIL);
+	}
+
+	if (result == EXIT_SUCCESS)
+	{
+		fp = fopen(headerPath, "w");
+
+		if (!fp)
+		{
+			result = Fail("could not open %s", headerPath);
+		}
+		else
+		{
+			WriteHeader(fp, &schema, argv[1], argv[3]);
+
+			if (fclose(fp) != 0)
+				result = Fail("could not write %s", headerPath);
+		}
+	}
+
+	if (result == EXIT_SUCCESS)
+	{
+		fp = fopen(sourcePath, "w");
+
+		if (!fp)
+		{
+			result = Fail("could not open %s", sourcePath);
+		}
+		else
+		{
+			/* The source includes the header by its file name alone. */
+			result = WriteSource(fp, &schema, argv[1], FileName(headerPath),
+				argv[3]);
+
+			if (fclose(fp) != 0 && result == EXIT_SUCCESS)
+				result = Fail("could not write %s", sourcePath);
+		}
+	}
+
+	free(headerPath);
+	free(sourcePath);
+	FreeSchema(&schema);
+	IniFile_Free(file);
+
+	return result;
+}
@@ -0,0 +1,52 @@
+/**
+ * main.c - Checks the code inischema generates from schema.ini.
+ *
+ * CIniFile: C implementation of reading ini configuration files.
+ * An open source project of HYPEWORKS.
+ *
+ * Copyright (C) 2017-2021 HYPEWORKS Ltd Co.
+ */
+
+/*
+ * This software library is open source and licensed under the MIT License.
+ *
+ * Read LICENSE for the full license text.
+ */
+
+#include "config.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CHECK(x) if (!(x)) { printf("FAIL: %s on line %d\n", #x, __LINE__); \
+	return 1; }
+
+int main(void)
+{
+	const char* text = "[limits]\nwhole = 7\nhex = 0x1p-1\nname = bound\n";
+	Config config;
+
+	Config_SetDefaults(&config);
+
+	CHECK(config.ratio == 0.5);
+	CHECK(config.limits.lowest == LONG_MIN);
+	CHECK(config.limits.highest == LONG_MAX);
+	CHECK(config.limits.whole == 42.0);
+	CHECK(config.limits.hex == 16.0);
+	CHECK(isinf(config.limits.large) && config.limits.large > 0);
+	CHECK(isinf(config.limits.small) && config.limits.small < 0);
+	CHECK(isnan(config.limits.missing));
+	CHECK(config.limits.tiny == 1e-3);
+	CHECK(strcmp(config.limits.name, "limits") == 0);
+	CHECK(config.limits.enabled);
+
+	CHECK(Config_Bind(&config, text, strlen(text), NULL));
+	CHECK(config.limits.whole == 7.0);
+	CHECK(config.limits.hex == 0.5);
+	CHECK(strcmp(config.limits.name, "bound") == 0);
+	CHECK(config.ratio == 0.5);
+
+	return 0;
+}
@@ -0,0 +1,39 @@
+#!/bin/sh
+#
+# Generates code from the schema next to this script, compiles it with
+# warnings as errors and runs checks against it.
+#
+# Usage: run.sh <path to inischema>
+#
+# CC picks the compiler, cc by default.
+
+inischema=$1
+dir=$(dirname "$0")
+library="$dir/../../CIniFile"
+work=$(mktemp -d)
+failed=0
+
+if ! "$inischema" "$dir/schema.ini" "$work/config" Config; then
+	echo "FAIL: inischema could not generate code"
+	failed=1
+elif ! ${CC:-cc} -Wall -Werror -I"$library" -c "$work/config.c" \
+	-o "$work/config.o"
+then
+	echo "FAIL: the generated code does not compile"
+	failed=1
+elif ! ${CC:-cc} -I"$library" -I"$work" "$dir/main.c" "$work/config.o" \
+	"$library/IniFile.c" -lm -o "$work/check" 2>/dev/null
+then
+	echo "FAIL: the checks do not build"
+	failed=1
+elif ! "$work/check"; then
+	failed=1
+fi
+
+rm -rf "$work"
+
+if [ "$failed" -ne 0 ]; then
+	exit 1
+fi
+
+echo "inischema: OK"